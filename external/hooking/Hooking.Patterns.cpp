@@ -11,9 +11,28 @@
 
 #include <windows.h>
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_IX86) || defined(_M_AMD64) || defined(__i386__) || defined(__x86_64__)
+#define PATTERNS_USE_SIMD 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PATTERNS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define PATTERNS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define PATTERNS_USE_SIMD 0
+#endif
 
 #if PATTERNS_USE_HINTS
 #include <map>
+#include <set>
 #endif
 
 #if PATTERNS_USE_HINTS
@@ -58,6 +77,10 @@ namespace hook
 
 #if PATTERNS_USE_HINTS
 static std::multimap<uint64_t, uintptr_t> g_hints;
+
+// patterns a batch scan in this process found nothing for; never seeded from outside, since a miss can't be
+// validated without the scan it would save
+static std::set<uint64_t> g_missing;
 #endif
 
 static void TransformPattern(const char *pattern, std::vector<uint8_t>& data, std::vector<uint8_t>& mask)
@@ -207,8 +230,29 @@ void pattern::Initialize(const char* pattern)
     // transform the base pattern from IDA format to canonical format
     TransformPattern(pattern, m_bytes, m_mask);
 
+    m_literal = {};
     m_size = m_mask.size();
 
+    ConsiderHints();
+}
+
+void pattern::Initialize(const pattern_view& literal)
+{
+    // already parsed (and hashed) at compile time, nothing to allocate
+#if PATTERNS_USE_HINTS
+    m_hash = literal.hash;
+#endif
+
+    m_bytes.clear();
+    m_mask.clear();
+    m_literal = literal;
+    m_size = literal.size;
+
+    ConsiderHints();
+}
+
+void pattern::ConsiderHints()
+{
 #if PATTERNS_USE_HINTS
     // if there's hints, try those first
     if (m_module == GetModuleHandle(nullptr))
@@ -229,98 +273,553 @@ void pattern::Initialize(const char* pattern)
                 return;
             }
         }
+        else if (g_missing.find(m_hash) != g_missing.end())
+        {
+            // a batch scan in this process already established there's nothing to find
+            m_matched = true;
+            return;
+        }
     }
 #endif
 }
 
-void pattern::EnsureMatches(uint32_t maxCount)
+static scan_isa g_requestedScanIsa = scan_isa::automatic;
+
+void set_scan_isa(scan_isa isa)
 {
-    if (m_matched)
-        return;
+    g_requestedScanIsa = isa;
+}
 
-    if (!m_rangeStart && !m_rangeEnd && !m_module)
-        return;
+static unsigned g_requestedScanThreads = 1;
 
-    // scan the executable for code
-    executable_meta executable = m_rangeStart != 0 && m_rangeEnd != 0 ? executable_meta(m_rangeStart, m_rangeEnd) : executable_meta(m_module);
+void set_scan_threads(unsigned count)
+{
+    g_requestedScanThreads = count;
+}
+
+unsigned get_scan_threads()
+{
+    if (g_requestedScanThreads != 0)
+        return (std::min)(g_requestedScanThreads, 64u);
 
-    auto matchSuccess = [&] (uintptr_t address)
+    // past a handful of threads the scan is bound by memory bandwidth, not compares
+    return (std::min)((std::max)(std::thread::hardware_concurrency(), 1u), 8u);
+}
+
+#if PATTERNS_USE_SIMD
+static void QueryCpuid(int leaf, int subleaf, int regs[4])
+{
+#ifdef _MSC_VER
+    __cpuidex(regs, leaf, subleaf);
+#else
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+    regs[0] = int(a); regs[1] = int(b); regs[2] = int(c); regs[3] = int(d);
+#endif
+}
+
+static uint64_t QueryXcr0()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int lo = 0, hi = 0;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (uint64_t(hi) << 32) | lo;
+#endif
+}
+
+static scan_isa DetectScanIsa()
+{
+    int regs[4] = {};
+    QueryCpuid(0, 0, regs);
+    const int maxLeaf = regs[0];
+
+    QueryCpuid(1, 0, regs);
+    const bool sse2 = (regs[3] & (1 << 26)) != 0;
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx = (regs[2] & (1 << 28)) != 0;
+
+    if (!sse2)
+        return scan_isa::scalar;
+
+    // AVX2 also needs the OS to save the upper YMM state across context switches
+    if (maxLeaf >= 7 && osxsave && avx && (QueryXcr0() & 0x6) == 0x6)
     {
-#if PATTERNS_USE_HINTS
-        g_hints.emplace(m_hash, address);
+        QueryCpuid(7, 0, regs);
+        if ((regs[1] & (1 << 5)) != 0)
+            return scan_isa::avx2;
+    }
+
+    return scan_isa::sse2;
+}
+#endif
+
+static scan_isa GetScanIsa()
+{
+#if PATTERNS_USE_SIMD
+    static const scan_isa detected = DetectScanIsa();
+
+    switch (g_requestedScanIsa)
+    {
+    case scan_isa::scalar:
+        return scan_isa::scalar;
+    case scan_isa::sse2:
+        return detected == scan_isa::scalar ? scan_isa::scalar : scan_isa::sse2;
+    default:
+        return detected;
+    }
 #else
-        (void)address;
+    return scan_isa::scalar;
 #endif
+}
 
-        return (m_matches.size() == maxCount);
-    };
+// rough frequency of each byte value in 32-bit x86 code; anchors on rare bytes produce fewer candidates
+static inline uint32_t GetByteCommonness(uint8_t value)
+{
+    switch (value)
+    {
+    case 0x00: case 0xFF: case 0x8B: case 0x89: case 0xE8: case 0x83:
+    case 0xC4: case 0x24: case 0x44: case 0x0F: case 0xCC: case 0x90:
+        return 8;
+    case 0x01: case 0x04: case 0x05: case 0x08: case 0x0D: case 0x10:
+    case 0x15: case 0x33: case 0x3D: case 0x45: case 0x46: case 0x4C:
+    case 0x50: case 0x51: case 0x52: case 0x53: case 0x55: case 0x56:
+    case 0x57: case 0x5D: case 0x5E: case 0x5F: case 0x6A: case 0x74:
+    case 0x75: case 0x84: case 0x85: case 0x8D: case 0xC0: case 0xC3:
+        return 4;
+    default:
+        return 1;
+    }
+}
 
-    ptrdiff_t BadCharacter[256];
+// picks the rarest pair of adjacent fully-masked bytes
+static bool SelectScanAnchor(const uint8_t* bytes, const uint8_t* mask, size_t size, size_t& anchor)
+{
+    uint32_t bestScore = UINT32_MAX;
 
-    std::ptrdiff_t index;
+    for (size_t i = 0; i + 1 < size; i++)
+    {
+        if (mask[i] != 0xFF || mask[i + 1] != 0xFF)
+            continue;
+
+        const uint32_t score = GetByteCommonness(bytes[i]) * GetByteCommonness(bytes[i + 1]);
+        if (score < bestScore)
+        {
+            bestScore = score;
+            anchor = i;
+        }
+    }
+
+    return bestScore != UINT32_MAX;
+}
+
+#if PATTERNS_USE_SIMD
+static inline uint32_t LowestSetBit(uint32_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return uint32_t(index);
+#else
+    return uint32_t(__builtin_ctz(value));
+#endif
+}
+
+struct anchored_scan
+{
+    const uint8_t* bytes;
+    const uint8_t* mask;
+    size_t size;
+    size_t anchor;
+    uintptr_t first;      // lowest match start
+    uintptr_t last;       // highest match start
+    uintptr_t nextAllowed;
+};
+
+static inline bool AnchoredCompare(const anchored_scan& scan, const uint8_t* ptr)
+{
+    for (size_t i = 0; i < scan.size; i++)
+    {
+        if ((scan.bytes[i] & scan.mask[i]) != (ptr[i] & scan.mask[i]))
+            return false;
+    }
+
+    return true;
+}
+
+// tests one candidate start; returns true once the caller's match callback asks to stop
+template<typename TMatch>
+static inline bool AnchoredCandidate(anchored_scan& scan, uintptr_t start, TMatch& onMatch)
+{
+    // matches of one pattern never overlap, same as the Boyer-Moore-Horspool path
+    if (start < scan.nextAllowed || !AnchoredCompare(scan, reinterpret_cast<const uint8_t*>(start)))
+        return false;
+
+    scan.nextAllowed = start + scan.size;
+    return onMatch(start);
+}
+
+template<typename TMatch>
+static uintptr_t AnchoredScalarTail(anchored_scan& scan, uintptr_t start, TMatch& onMatch)
+{
+    for (; start <= scan.last; start++)
+    {
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(start + scan.anchor);
+        if (ptr[0] == scan.bytes[scan.anchor] && ptr[1] == scan.bytes[scan.anchor + 1] && AnchoredCandidate(scan, start, onMatch))
+            return start;
+    }
+
+    return 0;
+}
+
+template<typename TMatch>
+static void ScanAnchoredSse2(anchored_scan& scan, TMatch& onMatch)
+{
+    const __m128i first = _mm_set1_epi8(char(scan.bytes[scan.anchor]));
+    const __m128i second = _mm_set1_epi8(char(scan.bytes[scan.anchor + 1]));
+
+    uintptr_t start = scan.first;
+
+    // each step tests 16 anchor positions; the load of the second byte reads one past them
+    for (; start + 16 <= scan.last + 1; start += 16)
+    {
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(start + scan.anchor);
+        const __m128i hitFirst = _mm_cmpeq_epi8(first, _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+        const __m128i hitSecond = _mm_cmpeq_epi8(second, _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 1)));
+        uint32_t candidates = uint32_t(_mm_movemask_epi8(_mm_and_si128(hitFirst, hitSecond)));
+
+        while (candidates != 0)
+        {
+            const uint32_t bit = LowestSetBit(candidates);
+            candidates &= candidates - 1;
+
+            if (AnchoredCandidate(scan, start + bit, onMatch))
+                return;
+        }
+    }
+
+    AnchoredScalarTail(scan, start, onMatch);
+}
+
+template<typename TMatch>
+PATTERNS_TARGET_AVX2 static void ScanAnchoredAvx2(anchored_scan& scan, TMatch& onMatch)
+{
+    const __m256i first = _mm256_set1_epi8(char(scan.bytes[scan.anchor]));
+    const __m256i second = _mm256_set1_epi8(char(scan.bytes[scan.anchor + 1]));
+
+    uintptr_t start = scan.first;
+
+    for (; start + 32 <= scan.last + 1; start += 32)
+    {
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(start + scan.anchor);
+        const __m256i hitFirst = _mm256_cmpeq_epi8(first, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+        const __m256i hitSecond = _mm256_cmpeq_epi8(second, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + 1)));
+        uint32_t candidates = uint32_t(_mm256_movemask_epi8(_mm256_and_si256(hitFirst, hitSecond)));
+
+        while (candidates != 0)
+        {
+            const uint32_t bit = LowestSetBit(candidates);
+            candidates &= candidates - 1;
+
+            if (AnchoredCandidate(scan, start + bit, onMatch))
+            {
+                _mm256_zeroupper();
+                return;
+            }
+        }
+    }
+
+    _mm256_zeroupper();
+    AnchoredScalarTail(scan, start, onMatch);
+}
+#endif
+
+struct scan_job
+{
+    const uint8_t* bytes;
+    const uint8_t* mask;
+    size_t size;
+    uint32_t maxCount;
+    scan_isa isa;
+    bool anchored;
+    size_t anchor;
+    ptrdiff_t badCharacter[256];
+};
 
-    const std::uint8_t *pbytes = m_bytes.data();
-    const std::uint8_t *pmask = m_mask.data();
+static void PrepareScanJob(scan_job& job, const uint8_t* bytes, const uint8_t* mask, size_t size, uint32_t maxCount)
+{
+    job.bytes = bytes;
+    job.mask = mask;
+    job.size = size;
+    job.maxCount = maxCount;
+    job.isa = GetScanIsa();
+    job.anchored = false;
+    job.anchor = 0;
+
+#if PATTERNS_USE_SIMD
+    // vector path: find candidates by an anchor byte pair, then run the masked compare on those only
+    if (job.isa != scan_isa::scalar && SelectScanAnchor(bytes, mask, size, job.anchor))
+    {
+        job.anchored = true;
+        return;
+    }
+#endif
 
     for (std::uint32_t bc = 0; bc < 256; ++bc)
     {
-        for (index = m_size - 1; index >= 0; --index)
+        std::ptrdiff_t index;
+        for (index = size - 1; index >= 0; --index)
         {
-            if ((pbytes[index] & pmask[index]) == (bc & pmask[index]))
+            if ((bytes[index] & mask[index]) == (bc & mask[index]))
             {
                 break;
             }
         }
 
-        BadCharacter[bc] = index;
+        job.badCharacter[bc] = index;
     }
+}
 
-    __try
+template<typename TMatch>
+static void ScanBoyerMooreHorspool(const scan_job& job, uintptr_t first, uintptr_t last, TMatch& onMatch)
+{
+    const std::uint8_t *pbytes = job.bytes;
+    const std::uint8_t *pmask = job.mask;
+    std::ptrdiff_t index;
+
+    for (uintptr_t i = first; i <= last;)
     {
-        for (uintptr_t i = executable.begin(), end = executable.end() - m_size; i <= end;)
+        uint8_t* ptr = reinterpret_cast<uint8_t*>(i);
+
+        for (index = job.size - 1; index >= 0; --index)
         {
-            uint8_t* ptr = reinterpret_cast<uint8_t*>(i);
+            if ((pbytes[index] & pmask[index]) != (ptr[index] & pmask[index]))
+            {
+                break;
+            }
+        }
 
-            for (index = m_size - 1; index >= 0; --index)
+        if (index == -1)
+        {
+            if (onMatch(i))
             {
-                if ((pbytes[index] & pmask[index]) != (ptr[index] & pmask[index]))
-                {
-                    break;
-                }
+                break;
             }
 
-            if (index == -1)
+            i += job.size;
+        }
+        else
+        {
+            i += (std::max)(index - job.badCharacter[ptr[index]], std::ptrdiff_t(1));
+        }
+    }
+}
+
+// collects the non-overlapping matches starting in [first, last], stopping at maxCount;
+// kept free of objects with destructors so it can use SEH
+static void ScanSpan(const scan_job& job, uintptr_t first, uintptr_t last, std::vector<uintptr_t>& matches)
+{
+    auto onMatch = [&] (uintptr_t address)
+    {
+        matches.push_back(address);
+        return (matches.size() == job.maxCount);
+    };
+
+    __try
+    {
+#if PATTERNS_USE_SIMD
+        if (job.anchored)
+        {
+            anchored_scan scan = { job.bytes, job.mask, job.size, job.anchor, first, last, 0 };
+
+            if (job.isa == scan_isa::avx2)
+                ScanAnchoredAvx2(scan, onMatch);
+            else
+                ScanAnchoredSse2(scan, onMatch);
+        }
+        else
+#endif
+        {
+            ScanBoyerMooreHorspool(job, first, last, onMatch);
+        }
+    }
+    __except ((GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION) ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    { }
+}
+
+// below this many bytes the thread startup costs more than the scan
+static const size_t kParallelScanMinimum = 512 * 1024;
+static const size_t kParallelChunkMinimum = 64 * 1024;
+
+struct scan_chunk
+{
+    uintptr_t begin;
+    uintptr_t end;
+    bool scanned;
+    std::vector<uintptr_t> matches;
+};
+
+// splits [begin, end) into a few chunks per thread so uneven match density still balances out
+static std::vector<scan_chunk> SplitScanRange(uintptr_t begin, uintptr_t end, unsigned threads)
+{
+    const size_t length = end - begin;
+    const size_t chunkSize = (std::max)(kParallelChunkMinimum, (length + threads * 4 - 1) / (threads * 4));
+
+    std::vector<scan_chunk> chunks;
+    for (uintptr_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize)
+    {
+        chunks.push_back({ chunkBegin, (std::min)(chunkBegin + chunkSize, end), false, {} });
+    }
+
+    return chunks;
+}
+
+// hands chunks out in address order to the calling thread plus threads - 1 workers. once scanChunk
+// reports a chunk as sufficient on its own, later chunks aren't started; the merge covers any it still needs
+template<typename TScan>
+static void RunScanChunks(size_t chunkCount, unsigned threads, TScan& scanChunk)
+{
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> limit(SIZE_MAX);
+
+    auto worker = [&] ()
+    {
+        for (size_t idx = next++; idx < chunkCount && idx <= limit.load(); idx = next++)
+        {
+            if (scanChunk(idx))
             {
-                m_matches.emplace_back(ptr);
+                size_t current = limit.load();
+                while (idx < current && !limit.compare_exchange_weak(current, idx))
+                { }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads && i < chunkCount; i++)
+    {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : pool)
+    {
+        thread.join();
+    }
+}
+
+// replays the serial scan over per-chunk results, taking the first match start of each chunk from first(chunk).
+// a chunk whose first match overlaps the last one taken is rescanned from where the serial scan would resume,
+// so the merged list is exactly what a single pass would have produced
+template<typename TFirst, typename TLast>
+static void MergeScanChunks(const scan_job& job, std::vector<scan_chunk>& chunks, TFirst& first, TLast& last, std::vector<uintptr_t>& out)
+{
+    uintptr_t nextAllowed = 0;
+
+    for (auto& chunk : chunks)
+    {
+        if (!out.empty() && out.size() == job.maxCount)
+        {
+            break;
+        }
 
-                if (matchSuccess(i))
-                {
-                    break;
-                }
+        if (!chunk.scanned || (!chunk.matches.empty() && chunk.matches.front() < nextAllowed))
+        {
+            const uintptr_t resumeAt = (std::max)(first(chunk), nextAllowed);
 
-                i += m_size;
+            chunk.matches.clear();
+            if (resumeAt <= last(chunk))
+            {
+                ScanSpan(job, resumeAt, last(chunk), chunk.matches);
             }
-            else
+        }
+
+        for (uintptr_t address : chunk.matches)
+        {
+            out.push_back(address);
+            nextAllowed = address + job.size;
+
+            if (out.size() == job.maxCount)
             {
-                i += max(index - BadCharacter[ptr[index]], 1);
+                break;
             }
         }
     }
-    __except ((GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION) ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) 
-    { }
+}
+
+// scans match starts in [first, last], on worker threads when configured to and the range is large enough
+static void ScanRange(const scan_job& job, uintptr_t first, uintptr_t last, std::vector<uintptr_t>& out)
+{
+    const unsigned threads = get_scan_threads();
+
+    if (threads <= 1 || last - first < kParallelScanMinimum)
+    {
+        ScanSpan(job, first, last, out);
+        return;
+    }
+
+    // chunks partition the match starts; each one reads size - 1 bytes into the next
+    std::vector<scan_chunk> chunks = SplitScanRange(first, last + 1, threads);
+
+    auto scanChunk = [&] (size_t idx)
+    {
+        scan_chunk& chunk = chunks[idx];
+        ScanSpan(job, chunk.begin, chunk.end - 1, chunk.matches);
+        chunk.scanned = true;
+
+        return (job.maxCount != 0 && chunk.matches.size() == job.maxCount);
+    };
+
+    RunScanChunks(chunks.size(), threads, scanChunk);
+
+    auto chunkFirst = [] (const scan_chunk& chunk) { return chunk.begin; };
+    auto chunkLast = [] (const scan_chunk& chunk) { return chunk.end - 1; };
+    MergeScanChunks(job, chunks, chunkFirst, chunkLast, out);
+}
+
+void pattern::EnsureMatches(uint32_t maxCount)
+{
+    if (m_matched)
+        return;
+
+    if (!m_rangeStart && !m_rangeEnd && !m_module)
+        return;
+
+    // scan the executable for code
+    executable_meta executable = m_rangeStart != 0 && m_rangeEnd != 0 ? executable_meta(m_rangeStart, m_rangeEnd) : executable_meta(m_module);
     m_matched = true;
+
+    if (executable.end() - executable.begin() < m_size)
+        return;
+
+    scan_job job;
+    PrepareScanJob(job, bytes(), mask(), m_size, maxCount);
+
+    std::vector<uintptr_t> found;
+    ScanRange(job, executable.begin(), executable.end() - m_size, found);
+
+    for (uintptr_t address : found)
+    {
+        m_matches.emplace_back(reinterpret_cast<void*>(address));
+
+#if PATTERNS_USE_HINTS
+        g_hints.emplace(m_hash, address);
+#endif
+    }
 }
 
 bool pattern::ConsiderMatch(uintptr_t offset)
 {
-    const uint8_t* pattern = m_bytes.data();
-    const uint8_t* mask = m_mask.data();
+    const uint8_t* pattern = bytes();
+    const uint8_t* patternMask = mask();
 
     char* ptr = reinterpret_cast<char*>(offset);
 
     for (size_t i = 0; i < m_size; i++)
     {
-        if ((pattern[i] & mask[i]) != (ptr[i] & mask[i]))
+        if ((pattern[i] & patternMask[i]) != (ptr[i] & patternMask[i]))
         {
             return false;
         }
@@ -347,4 +846,557 @@ void pattern::hint(uint64_t hash, uintptr_t address)
     g_hints.emplace(hash, address);
 }
 #endif
+
+#if PATTERNS_USE_HINTS
+std::vector<std::pair<uint64_t, uintptr_t>> pattern::get_hints()
+{
+    return std::vector<std::pair<uint64_t, uintptr_t>>(g_hints.begin(), g_hints.end());
+}
+
+void pattern::clear_hints()
+{
+    g_hints.clear();
+    g_missing.clear();
+}
+
+struct batch_anchor
+{
+    uint32_t entry;
+    uint32_t offset;
+    uint8_t second;
+    bool hasSecond;
+};
+
+struct batch_state
+{
+    const uint8_t* bytes;
+    const uint8_t* mask;
+    size_t size;
+    uint32_t maxCount;
+    uintptr_t nextAllowed;
+    std::vector<uintptr_t>* matches;
+};
+
+// anchors on the rarest fully-masked byte pair, falling back to a lone fully-masked byte
+static bool SelectBatchAnchor(const uint8_t* bytes, const uint8_t* mask, size_t size, uint32_t& offset, bool& hasSecond)
+{
+    size_t anchor = 0;
+    if (SelectScanAnchor(bytes, mask, size, anchor))
+    {
+        offset = uint32_t(anchor);
+        hasSecond = true;
+        return true;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if (mask[i] == 0xFF)
+        {
+            offset = uint32_t(i);
+            hasSecond = false;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline bool BatchCompare(const batch_state& state, const uint8_t* ptr)
+{
+    for (size_t i = 0; i < state.size; i++)
+    {
+        if ((state.bytes[i] & state.mask[i]) != (ptr[i] & state.mask[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static inline void BatchConsider(batch_state& state, uintptr_t start, uintptr_t begin, uintptr_t end, size_t& pending)
+{
+    // mirror pattern::EnsureMatches: matches of one pattern never overlap, and stop at maxCount
+    if (state.matches->size() >= state.maxCount || start < begin || start < state.nextAllowed || start + state.size > end)
+    {
+        return;
+    }
+
+    if (!BatchCompare(state, reinterpret_cast<const uint8_t*>(start)))
+    {
+        return;
+    }
+
+    state.matches->push_back(start);
+    state.nextAllowed = start + state.size;
+
+    if (state.matches->size() == state.maxCount)
+    {
+        --pending;
+    }
+}
+
+// SSE2 has no byte shuffle for the nibble classes, so its prefilter compares against each distinct anchor instead;
+// past this many it costs more than it saves and the scan walks every position
+static const size_t kBatchSse2Anchors = 32;
+
+struct batch_tables
+{
+    uintptr_t begin;        // bounds of the whole image; matches may not cross them
+    uintptr_t end;
+    const batch_anchor* anchors;
+    const uint32_t* bucketStart;
+    const uint64_t* pairFilter;
+    const uint32_t* unanchored;
+    size_t unanchoredCount;
+    batch_state* states;
+    uint8_t firstLow[16];   // nibble classes of every anchor's first byte, see ScanBatchBlocksAvx2
+    uint8_t firstHigh[16];
+    uint8_t sse2First[kBatchSse2Anchors];  // distinct anchor pairs, then anchors on a lone byte, see ScanBatchBlocksSse2
+    uint8_t sse2Second[kBatchSse2Anchors];
+    uint32_t sse2PairCount;
+    uint32_t sse2AnchorCount;               // 0 if they didn't fit
+};
+
+static inline void BatchPosition(const batch_tables& tables, uintptr_t p, size_t& pending)
+{
+    const uintptr_t begin = tables.begin;
+    const uintptr_t end = tables.end;
+    const uint8_t value = *reinterpret_cast<const uint8_t*>(p);
+
+    // one bit test on the byte pair rejects almost every position before touching the buckets
+    if (tables.unanchoredCount == 0 && p + 1 < end)
+    {
+        const uint32_t key = value | (uint32_t(*reinterpret_cast<const uint8_t*>(p + 1)) << 8);
+        if ((tables.pairFilter[key >> 6] & (uint64_t(1) << (key & 63))) == 0)
+        {
+            return;
+        }
+    }
+
+    for (uint32_t idx = tables.bucketStart[value], last = tables.bucketStart[value + 1]; idx < last; ++idx)
+    {
+        const batch_anchor& anchor = tables.anchors[idx];
+
+        if (anchor.hasSecond && (p + 1 >= end || *reinterpret_cast<const uint8_t*>(p + 1) != anchor.second))
+        {
+            continue;
+        }
+
+        BatchConsider(tables.states[anchor.entry], p - anchor.offset, begin, end, pending);
+    }
+
+    for (size_t i = 0; i < tables.unanchoredCount; ++i)
+    {
+        BatchConsider(tables.states[tables.unanchored[i]], p, begin, end, pending);
+    }
+}
+
+#if PATTERNS_USE_SIMD
+// compares 16 positions at once against every distinct anchor pair (or lone anchor byte),
+// so only positions that may start an anchor reach BatchPosition
+static uintptr_t ScanBatchBlocksSse2(const batch_tables& tables, uintptr_t from, uintptr_t to, size_t& pending)
+{
+    __m128i first[kBatchSse2Anchors];
+    __m128i second[kBatchSse2Anchors];
+    for (uint32_t i = 0; i < tables.sse2AnchorCount; i++)
+    {
+        first[i] = _mm_set1_epi8(char(tables.sse2First[i]));
+        second[i] = _mm_set1_epi8(char(tables.sse2Second[i]));
+    }
+
+    uintptr_t p = from;
+
+    // the load of the second byte reads one past the 16 positions
+    for (; p + 17 <= to && pending != 0; p += 16)
+    {
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        __m128i hits = _mm_setzero_si128();
+
+        uint32_t i = 0;
+        for (; i < tables.sse2PairCount; i++)
+        {
+            hits = _mm_or_si128(hits, _mm_and_si128(_mm_cmpeq_epi8(data, first[i]), _mm_cmpeq_epi8(next, second[i])));
+        }
+
+        for (; i < tables.sse2AnchorCount; i++)
+        {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(data, first[i]));
+        }
+
+        uint32_t candidates = uint32_t(_mm_movemask_epi8(hits));
+
+        while (candidates != 0 && pending != 0)
+        {
+            const uint32_t bit = LowestSetBit(candidates);
+            candidates &= candidates - 1;
+
+            BatchPosition(tables, p + bit, pending);
+        }
+    }
+
+    return p;
+}
+
+// classifies 32 bytes at once by nibble lookups (byte is a candidate if low & high class bits intersect),
+// so only positions whose byte may start an anchor reach BatchPosition
+PATTERNS_TARGET_AVX2 static uintptr_t ScanBatchBlocksAvx2(const batch_tables& tables, uintptr_t from, uintptr_t to, size_t& pending)
+{
+    const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.firstLow)));
+    const __m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.firstHigh)));
+    const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    uintptr_t p = from;
+    for (; p + 32 <= to && pending != 0; p += 32)
+    {
+        const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i low = _mm256_shuffle_epi8(lowTable, _mm256_and_si256(data, nibbleMask));
+        const __m256i high = _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi16(data, 4), nibbleMask));
+        const __m256i classes = _mm256_and_si256(low, high);
+        uint32_t candidates = ~uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(classes, zero)));
+
+        while (candidates != 0 && pending != 0)
+        {
+            const uint32_t bit = LowestSetBit(candidates);
+            candidates &= candidates - 1;
+
+            BatchPosition(tables, p + bit, pending);
+        }
+    }
+
+    _mm256_zeroupper();
+    return p;
+}
+#endif
+
+// visits anchor positions in [from, to) and returns how many patterns still want matches;
+// kept free of objects with destructors so it can use SEH
+static size_t ScanBatchRange(const batch_tables& tables, uintptr_t from, uintptr_t to, size_t pending)
+{
+    __try
+    {
+        uintptr_t p = from;
+
+#if PATTERNS_USE_SIMD
+        if (tables.unanchoredCount == 0)
+        {
+            const scan_isa isa = GetScanIsa();
+            if (isa == scan_isa::avx2)
+            {
+                p = ScanBatchBlocksAvx2(tables, from, to, pending);
+            }
+            else if (isa == scan_isa::sse2 && tables.sse2AnchorCount != 0)
+            {
+                p = ScanBatchBlocksSse2(tables, from, to, pending);
+            }
+        }
+#endif
+
+        for (; p < to && pending != 0; ++p)
+        {
+            BatchPosition(tables, p, pending);
+        }
+    }
+    __except ((GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION) ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    { }
+
+    return pending;
+}
+
+// runs the batch over chunks of the image on worker threads, each chunk with its own copy of the per-pattern
+// state, then merges every pattern's per-chunk matches the same way ScanRange does for a single pattern
+static void ScanBatchParallel(const batch_tables& tables, std::vector<batch_state>& states, const std::vector<uint32_t>& anchorOffsets, size_t pending, unsigned threads)
+{
+    const std::vector<scan_chunk> chunks = SplitScanRange(tables.begin, tables.end, threads);
+    std::vector<std::vector<scan_chunk>> entryChunks(states.size(), chunks);
+
+    auto scanChunk = [&] (size_t idx)
+    {
+        std::vector<batch_state> local = states;
+        for (size_t i = 0; i < local.size(); i++)
+        {
+            local[i].matches = &entryChunks[i][idx].matches;
+            entryChunks[i][idx].scanned = true;
+        }
+
+        batch_tables chunkTables = tables;
+        chunkTables.states = local.data();
+
+        return (ScanBatchRange(chunkTables, chunks[idx].begin, chunks[idx].end, pending) == 0);
+    };
+
+    RunScanChunks(chunks.size(), threads, scanChunk);
+
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        const batch_state& state = states[i];
+        if (state.maxCount == 0 || tables.end - tables.begin < state.size)
+        {
+            continue;
+        }
+
+        // a chunk sees the match starts whose anchor byte lies inside it
+        const uintptr_t offset = anchorOffsets[i];
+        const uintptr_t lowest = tables.begin;
+        const uintptr_t highest = tables.end - state.size;
+
+        auto chunkFirst = [&] (const scan_chunk& chunk)
+        {
+            return (chunk.begin - lowest < offset) ? lowest : chunk.begin - offset;
+        };
+
+        auto chunkLast = [&] (const scan_chunk& chunk) -> uintptr_t
+        {
+            // an empty range is reported as last < first
+            return (chunk.end - 1 - lowest < offset) ? 0 : (std::min)(chunk.end - 1 - offset, highest);
+        };
+
+        scan_job job;
+        PrepareScanJob(job, state.bytes, state.mask, state.size, state.maxCount);
+        MergeScanChunks(job, entryChunks[i], chunkFirst, chunkLast, *state.matches);
+    }
+}
+
+// checks that every hint recorded for the entry still holds, the same way pattern::ConsiderMatch would
+static bool ValidateBatchHints(const batch_state& state, uint64_t hash, uintptr_t begin, uintptr_t end)
+{
+    auto range = g_hints.equal_range(hash);
+    if (range.first == range.second)
+    {
+        return false;
+    }
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const uintptr_t address = it->second;
+        if (address < begin || address + state.size > end || !BatchCompare(state, reinterpret_cast<const uint8_t*>(address)))
+        {
+            g_hints.erase(range.first, range.second);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+pattern_batch::pattern_batch(void* module)
+    : m_module(module ? module : GetModuleHandle(nullptr)), m_scanned(0)
+{
+}
+
+pattern_batch& pattern_batch::add(const char* pattern, uint32_t maxCount)
+{
+    entry e;
+    e.hash = fnv_1()(pattern);
+    e.maxCount = maxCount ? maxCount : 1;
+    e.literal = {};
+    TransformPattern(pattern, e.bytes, e.mask);
+
+    if (!e.mask.empty())
+    {
+        m_entries.push_back(std::move(e));
+    }
+
+    return *this;
+}
+
+pattern_batch& pattern_batch::add(const pattern_view& literal, uint32_t maxCount)
+{
+    entry e;
+    e.hash = literal.hash;
+    e.maxCount = maxCount ? maxCount : 1;
+    e.literal = literal;
+
+    if (literal.size != 0)
+    {
+        m_entries.push_back(std::move(e));
+    }
+
+    return *this;
+}
+
+size_t pattern_batch::resolve()
+{
+    std::vector<batch_anchor> anchors;
+    std::vector<uint32_t> unanchored;
+    std::vector<batch_state> states(m_entries.size());
+    uint32_t bucketStart[257] = {};
+
+    executable_meta executable(m_module);
+    size_t matched = 0;
+    size_t pending = 0;
+    std::vector<uint32_t> anchorOffsets(m_entries.size(), 0);
+
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        entry& e = m_entries[i];
+        e.matches.clear();
+
+        if (e.literal.bytes)
+        {
+            states[i] = { e.literal.bytes, e.literal.mask, e.literal.size, e.maxCount, 0, &e.matches };
+        }
+        else
+        {
+            states[i] = { e.bytes.data(), e.mask.data(), e.mask.size(), e.maxCount, 0, &e.matches };
+        }
+
+        if (ValidateBatchHints(states[i], e.hash, executable.begin(), executable.end()))
+        {
+            states[i].maxCount = 0;
+            ++matched;
+            continue;
+        }
+
+        if (g_missing.find(e.hash) != g_missing.end())
+        {
+            states[i].maxCount = 0;
+            continue;
+        }
+
+        ++pending;
+
+        uint32_t offset = 0;
+        bool hasSecond = false;
+        if (SelectBatchAnchor(states[i].bytes, states[i].mask, states[i].size, offset, hasSecond))
+        {
+            anchorOffsets[i] = offset;
+            anchors.push_back({ uint32_t(i), offset, hasSecond ? states[i].bytes[offset + 1] : uint8_t(0), hasSecond });
+        }
+        else
+        {
+            unanchored.push_back(uint32_t(i));
+        }
+    }
+
+    // bucket the anchors by their first byte so every position in the image costs one table lookup
+    std::stable_sort(anchors.begin(), anchors.end(), [&] (const batch_anchor& left, const batch_anchor& right)
+    {
+        return states[left.entry].bytes[left.offset] < states[right.entry].bytes[right.offset];
+    });
+
+    std::vector<uint64_t> pairFilter(65536 / 64);
+    batch_tables tables = {};
+
+    for (const auto& anchor : anchors)
+    {
+        const uint8_t first = states[anchor.entry].bytes[anchor.offset];
+        bucketStart[first + 1]++;
+        tables.firstLow[first & 0x0F] |= uint8_t(1 << ((first >> 4) & 7));
+        tables.firstHigh[first >> 4] |= uint8_t(1 << ((first >> 4) & 7));
+
+        for (uint32_t second = 0; second < 256; second++)
+        {
+            if (anchor.hasSecond && second != anchor.second)
+            {
+                continue;
+            }
+
+            const uint32_t key = first | (second << 8);
+            pairFilter[key >> 6] |= uint64_t(1) << (key & 63);
+        }
+    }
+
+    for (size_t i = 1; i < 257; i++)
+    {
+        bucketStart[i] += bucketStart[i - 1];
+    }
+
+    // distinct pairs first, then lone bytes, the order ScanBatchBlocksSse2 expects
+    bool sse2Fits = true;
+    for (int lone = 0; lone < 2 && sse2Fits; lone++)
+    {
+        const uint32_t known = tables.sse2AnchorCount;
+
+        for (const auto& anchor : anchors)
+        {
+            if (anchor.hasSecond == (lone != 0))
+            {
+                continue;
+            }
+
+            const uint8_t first = states[anchor.entry].bytes[anchor.offset];
+            bool duplicate = false;
+            for (uint32_t i = known; i < tables.sse2AnchorCount && !duplicate; i++)
+            {
+                duplicate = tables.sse2First[i] == first && (lone != 0 || tables.sse2Second[i] == anchor.second);
+            }
+
+            if (duplicate)
+            {
+                continue;
+            }
+
+            if (tables.sse2AnchorCount == kBatchSse2Anchors)
+            {
+                sse2Fits = false;
+                break;
+            }
+
+            tables.sse2First[tables.sse2AnchorCount] = first;
+            tables.sse2Second[tables.sse2AnchorCount] = anchor.second;
+            tables.sse2AnchorCount++;
+        }
+
+        if (lone == 0)
+        {
+            tables.sse2PairCount = tables.sse2AnchorCount;
+        }
+    }
+
+    if (!sse2Fits)
+    {
+        tables.sse2AnchorCount = 0;
+    }
+
+    m_scanned = pending;
+    if (pending != 0)
+    {
+        tables.begin = executable.begin();
+        tables.end = executable.end();
+        tables.anchors = anchors.data();
+        tables.bucketStart = bucketStart;
+        tables.pairFilter = pairFilter.data();
+        tables.unanchored = unanchored.data();
+        tables.unanchoredCount = unanchored.size();
+        tables.states = states.data();
+
+        const unsigned threads = get_scan_threads();
+        if (threads <= 1 || executable.end() - executable.begin() < kParallelScanMinimum)
+        {
+            ScanBatchRange(tables, executable.begin(), executable.end(), pending);
+        }
+        else
+        {
+            ScanBatchParallel(tables, states, anchorOffsets, pending, threads);
+        }
+    }
+
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        const entry& e = m_entries[i];
+        if (states[i].maxCount == 0)
+        {
+            continue;
+        }
+
+        if (e.matches.empty())
+        {
+            g_missing.insert(e.hash);
+            continue;
+        }
+
+        for (uintptr_t address : e.matches)
+        {
+            pattern::hint(e.hash, address);
+        }
+
+        ++matched;
+    }
+
+    return matched;
+}
+#endif
 }
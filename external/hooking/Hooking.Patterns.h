@@ -7,10 +7,15 @@
 
 #pragma once
 
-#define PATTERNS_USE_HINTS 0
+#ifndef PATTERNS_USE_HINTS
+#define PATTERNS_USE_HINTS 1
+#endif
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace hook
@@ -20,10 +25,12 @@ namespace hook
     // sets the base address difference based on an obtained pointer
     inline void set_base(uintptr_t address)
     {
-#ifdef _M_IX86
+#if defined(_M_IX86) || defined(__i386__)
         uintptr_t addressDiff = (address - 0x400000);
-#elif defined(_M_AMD64)
+#elif defined(_M_AMD64) || defined(__x86_64__)
         uintptr_t addressDiff = (address - 0x140000000);
+#else
+        uintptr_t addressDiff = address;
 #endif
 
         // pointer-style cast to ensure unsigned overflow ends up copied directly into a signed value
@@ -33,17 +40,155 @@ namespace hook
     // sets the base to the process main base
     void set_base();
 
+    enum class scan_isa
+    {
+        automatic,
+        scalar,
+        sse2,
+        avx2
+    };
+
+    // selects the scanner implementation; automatic picks the widest one the CPU supports,
+    // scalar forces the original Boyer-Moore-Horspool loop
+    void set_scan_isa(scan_isa isa);
+
+    // number of threads a scan may split the executable across; 1 (the default) keeps every scan on
+    // the calling thread, 0 picks one per hardware thread. results are identical either way.
+    // don't raise this while the loader lock is held: the workers could never start.
+    void set_scan_threads(unsigned count);
+
+    // the thread count scans will actually use, with 0 resolved against the hardware
+    unsigned get_scan_threads();
+
     template<typename T>
     inline T* getRVA(uintptr_t rva)
     {
         set_base();
-#ifdef _M_IX86
+#if defined(_M_IX86) || defined(__i386__)
         return (T*)(baseAddressDifference + 0x400000 + rva);
-#elif defined(_M_AMD64)
+#elif defined(_M_AMD64) || defined(__x86_64__)
         return (T*)(baseAddressDifference + 0x140000000 + rva);
+#else
+        return (T*)(baseAddressDifference + rva);
 #endif
     }
 
+    // a pattern already split into bytes and mask; doesn't own its storage
+    struct pattern_view
+    {
+        const uint8_t* bytes;
+        const uint8_t* mask;
+        size_t size;
+
+        // same value hashing the IDA-style string gives, so hints are shared with string patterns
+        uint64_t hash;
+    };
+
+    namespace details
+    {
+        constexpr bool is_pattern_digit(char ch)
+        {
+            return (ch >= 'A' && ch <= 'F') || (ch >= 'a' && ch <= 'f') || (ch >= '0' && ch <= '9');
+        }
+
+        constexpr uint8_t pattern_nibble(char ch)
+        {
+            if (ch >= 'A' && ch <= 'F') return uint8_t(ch - 'A' + 10);
+            if (ch >= 'a' && ch <= 'f') return uint8_t(ch - 'a' + 10);
+            return uint8_t(ch - '0');
+        }
+
+        // reached from a constant expression, this is what turns a malformed pattern into a compile error
+        inline void malformed_pattern()
+        {
+        }
+    }
+
+    // a pattern parsed at compile time, with room for the longest pattern its string could spell
+    template<size_t Capacity>
+    struct pattern_literal
+    {
+        uint8_t bytes[Capacity];
+        uint8_t mask[Capacity];
+        size_t size;
+        uint64_t hash;
+
+        constexpr operator pattern_view() const
+        {
+            return { bytes, mask, size, hash };
+        }
+    };
+
+    // parses an IDA-style pattern ("8B 0D ? ? ? ?", also "?x"/"x?" nibble wildcards) the same way a
+    // pattern built from the string would. declare the result constexpr so bad patterns fail to compile.
+    template<size_t N>
+    constexpr pattern_literal<(N + 1) / 2> make_pattern(const char (&pattern_string)[N])
+    {
+        pattern_literal<(N + 1) / 2> result = {};
+
+        result.hash = 14695981039346656037u;
+        for (size_t i = 0; i + 1 < N; i++)
+        {
+            result.hash *= 1099511628211u;
+            result.hash ^= uint8_t(pattern_string[i]);
+        }
+
+        size_t i = 0;
+        while (i + 1 < N)
+        {
+            if (pattern_string[i] == ' ')
+            {
+                i++;
+                continue;
+            }
+
+            const char first = pattern_string[i];
+            const char second = i + 2 < N ? pattern_string[i + 1] : ' ';
+            const bool pair = second != ' ' && second != 0;
+            if (pair && i + 3 < N && pattern_string[i + 2] != ' ')
+            {
+                details::malformed_pattern();
+            }
+
+            uint8_t byte = 0;
+            uint8_t mask = 0;
+            if (first == '?' && (!pair || second == '?'))
+            {
+            }
+            else if (first == '?' && details::is_pattern_digit(second))
+            {
+                byte = details::pattern_nibble(second);
+                mask = 0x0F;
+            }
+            else if (pair && second == '?' && details::is_pattern_digit(first))
+            {
+                byte = uint8_t(details::pattern_nibble(first) << 4);
+                mask = 0xF0;
+            }
+            else if (pair && details::is_pattern_digit(first) && details::is_pattern_digit(second))
+            {
+                byte = uint8_t((details::pattern_nibble(first) << 4) | details::pattern_nibble(second));
+                mask = 0xFF;
+            }
+            else
+            {
+                details::malformed_pattern();
+            }
+
+            result.bytes[result.size] = byte;
+            result.mask[result.size] = mask;
+            result.size++;
+            i += pair ? 2 : 1;
+        }
+
+        if (result.size == 0)
+        {
+            details::malformed_pattern();
+        }
+
+        return result;
+    }
+
     class pattern_match
     {
     private:
@@ -69,6 +214,9 @@ namespace hook
         std::vector<uint8_t> m_bytes;
         std::vector<uint8_t> m_mask;
 
+        // set instead of the vectors above for patterns parsed at compile time
+        pattern_view m_literal = {};
+
 #if PATTERNS_USE_HINTS
         uint64_t m_hash;
 #endif
@@ -96,9 +244,23 @@ namespace hook
 
         void Initialize(const char* pattern);
 
+        void Initialize(const pattern_view& literal);
+
     private:
+        void ConsiderHints();
+
         bool ConsiderMatch(uintptr_t offset);
 
+        inline const uint8_t* bytes() const
+        {
+            return m_literal.bytes ? m_literal.bytes : m_bytes.data();
+        }
+
+        inline const uint8_t* mask() const
+        {
+            return m_literal.bytes ? m_literal.mask : m_mask.data();
+        }
+
         void EnsureMatches(uint32_t maxCount);
 
         inline const pattern_match& _get_internal(size_t index)
@@ -112,16 +274,22 @@ namespace hook
         {
         }
 
-        pattern(const char *pattern)
+        pattern(const char *pattern_string)
             : pattern(getRVA<void>(0))
         {
-            Initialize(pattern);
+            Initialize(pattern_string);
         }
 
-        pattern(const std::string& pattern)
+        pattern(const std::string& pattern_string)
             : pattern(getRVA<void>(0))
         {
-            Initialize(pattern.c_str());
+            Initialize(pattern_string.c_str());
+        }
+
+        pattern(const pattern_view& literal)
+            : pattern(getRVA<void>(0))
+        {
+            Initialize(literal);
         }
 
         inline pattern& count(uint32_t expected)
@@ -195,23 +363,80 @@ namespace hook
 #if PATTERNS_USE_HINTS
         // define a hint
         static void hint(uint64_t hash, uintptr_t address);
+
+        // snapshot of all hints, e.g. to persist them across runs
+        static std::vector<std::pair<uint64_t, uintptr_t>> get_hints();
+
+        // forget every hint and known miss, so the next lookup of any pattern scans again
+        static void clear_hints();
 #endif
     };
 
+#if PATTERNS_USE_HINTS
+    // collects many patterns and resolves all of them in a single pass over the executable,
+    // publishing the results as hints so later pattern() lookups with the same string don't scan
+    class pattern_batch
+    {
+    private:
+        struct entry
+        {
+            uint64_t hash;
+            std::vector<uint8_t> bytes;
+            std::vector<uint8_t> mask;
+            pattern_view literal;
+            uint32_t maxCount;
+            std::vector<uintptr_t> matches;
+        };
+
+        std::vector<entry> m_entries;
+        void* m_module;
+        size_t m_scanned;
+
+    public:
+        explicit pattern_batch(void* module = nullptr);
+
+        pattern_batch& add(const char* pattern, uint32_t maxCount = 1);
+
+        // the literal's storage has to outlive resolve()
+        pattern_batch& add(const pattern_view& literal, uint32_t maxCount = 1);
+
+        // scans once and returns the number of patterns that matched at least once;
+        // patterns whose existing hints still match (or that an earlier resolve() missed) aren't scanned for
+        size_t resolve();
+
+        inline size_t size() const
+        {
+            return m_entries.size();
+        }
+
+        // number of patterns the last resolve() had to scan for
+        inline size_t scanned() const
+        {
+            return m_scanned;
+        }
+    };
+#endif
+
     class module_pattern
         : public pattern
     {
     public:
-        module_pattern(void* module, const char *pattern)
+        module_pattern(void* module, const char *pattern_string)
             : pattern(module)
         {
-            Initialize(pattern);
+            Initialize(pattern_string);
         }
 
-        module_pattern(void* module, const std::string& pattern)
+        module_pattern(void* module, const std::string& pattern_string)
             : pattern(module)
         {
-            Initialize(pattern.c_str());
+            Initialize(pattern_string.c_str());
+        }
+
+        module_pattern(void* module, const pattern_view& literal)
+            : pattern(module)
+        {
+            Initialize(literal);
         }
     };
 
@@ -219,16 +444,22 @@ namespace hook
         : public pattern
     {
     public:
-        range_pattern(uintptr_t begin, uintptr_t end, const char *pattern)
+        range_pattern(uintptr_t begin, uintptr_t end, const char *pattern_string)
             : pattern(begin, end)
         {
-            Initialize(pattern);
+            Initialize(pattern_string);
         }
 
-        range_pattern(uintptr_t begin, uintptr_t end, const std::string& pattern)
+        range_pattern(uintptr_t begin, uintptr_t end, const std::string& pattern_string)
             : pattern(begin, end)
         {
-            Initialize(pattern.c_str());
+            Initialize(pattern_string.c_str());
+        }
+
+        range_pattern(uintptr_t begin, uintptr_t end, const pattern_view& literal)
+            : pattern(begin, end)
+        {
+            Initialize(literal);
         }
     };
 
@@ -238,4 +469,10 @@ namespace hook
     {
         return pattern(pattern_string).get_first<T>(offset);
     }
+
+    template<typename T = void>
+    auto get_pattern(const pattern_view& literal, ptrdiff_t offset = 0)
+    {
+        return pattern(literal).get_first<T>(offset);
+    }
 }
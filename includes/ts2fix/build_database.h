@@ -0,0 +1,9 @@
+#pragma once
+
+namespace ts2fix
+{
+// Publishes the built-in offsets for toy2.exe as pattern hints when its fingerprint is a known release. Like cache
+// entries they are only candidates: each is verified with a masked compare before use, and only the signatures whose
+// offset fails that are scanned for. Returns the release name, or nullptr for an unknown build.
+const char* ApplyKnownBuildOffsets();
+} // namespace ts2fix
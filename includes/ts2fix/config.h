@@ -4,21 +4,58 @@
 
 namespace ts2fix
 {
+enum class PacingBackend : uint8_t
+{
+	Auto = 0,      // WaitableTimer when high-resolution timers exist, SleepYield otherwise
+	SleepYield,    // Sleep/Sleep(0)/SwitchToThread, then a spin
+	WaitableTimer  // waitable timer, then a spin bounded by pacingSpinUs
+};
+
+enum class GameThreadPriority : uint8_t
+{
+	Default = 0,   // left as the game set it
+	AboveNormal,
+	Highest
+};
+
 struct FramerateConfig
 {
 	bool enabled = true;
 	bool diagnostics = false;
+	bool diagnosticTrace = false;
+	std::string diagnosticSubsystems; // comma-separated LogSubsystem names; empty = all
 	bool nativeRefreshRate = false;
 	int targetRefreshRate = 0;
 	bool autoFallbackTo60 = true;
 	uint32_t startupGuardMs = 5000;
 	bool frontendCustomTiming = false;
 	bool frontendZeroStep = false;
+	PacingBackend pacingBackend = PacingBackend::Auto;
+	uint32_t pacingSpinUs = 200;
+	bool frameTelemetry = false;
+	bool liveMetrics = true;
+	bool vblankLock = false;
+	uint32_t vblankMarginUs = 1500;
+	bool lateWait = false;
+	std::string inputPollCall;       // IDA-style pattern around the call to the game's input poll
+	int inputPollCallOffset = 0;     // offset of that call's E8 within the pattern
+	uint32_t lateWaitResidualUs = 500;
+	bool mmcss = false;
+	GameThreadPriority gameThreadPriority = GameThreadPriority::Default;
+	bool coreAffinity = false;
+	uint32_t backgroundFps = 30; // 0 = off, otherwise 20-60
 };
 
 struct RenderingConfig
 {
 	bool modernDepthPipeline = true;
+	bool modernDepthReversedZ = false;
+	bool modernDepthDynamicNear = true;
+	float modernDepthNearMin = 1.0f;
+	float modernDepthNearMax = 300.0f;
+	float modernDepthFar = 20000.0f;
+	std::string modernDepthFormat = "auto"; // lower case
+	bool modernDepthDebugOverlay = false;
 	bool widescreen = true;
 	bool zBufferFix = true;
 	float zBufferNearPlane = 100.0f;
@@ -35,11 +72,19 @@ struct CompatibilityConfig
 	bool skipSplash = true;
 };
 
+struct AdvancedConfig
+{
+	// 0 = one per hardware thread, 1 = serial scanning.
+	uint32_t scanThreads = 0;
+	bool readinessWatch = true;
+};
+
 struct Config
 {
 	FramerateConfig framerate = {};
 	RenderingConfig rendering = {};
 	CompatibilityConfig compatibility = {};
+	AdvancedConfig advanced = {};
 };
 
 Config LoadConfig(CIniReader& iniReader);
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "ts2fix/config.h"
+
+namespace ts2fix
+{
+// ToyStory2Fix.ini, read once per process and shared by the ASI and the ddraw.dll wrapper. The first module to ask
+// reads the file and publishes its path and text through the named mapping Local\ToyStory2Fix.Config.<pid>; both
+// modules parse that same text, so they always agree even if the file changes in between. Never changes once read. A
+// module from another build (different snapshot version) reads the file itself.
+const Config& GetSharedConfig();
+} // namespace ts2fix
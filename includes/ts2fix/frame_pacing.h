@@ -0,0 +1,17 @@
+#pragma once
+
+#include "ts2fix/config.h"
+#include "ts2fix/frame_timer_core.h"
+
+#include <cstdint>
+
+namespace ts2fix
+{
+void ConfigureFramePacing(const FramerateConfig& config);
+
+// Blocks the calling thread until QueryPerformanceCounter reaches deadlineQpc. pacingFrameTimeUs is the frame
+// length the deadline was derived from; the sleep/yield backend sizes its margins from it.
+PacingWaitSplit WaitForFrameDeadline(int64_t deadlineQpc, int pacingFrameTimeUs);
+
+const char* GetPacingBackendName();
+} // namespace ts2fix
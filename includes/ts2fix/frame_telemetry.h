@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ts2fix/config.h"
+#include "ts2fix/frame_timer.h"
+
+#include <cstdint>
+
+namespace ts2fix
+{
+// One paced frame, as seen by the frame-timer hook.
+struct FrameSample
+{
+	int64_t frameStartQpc; // hook entry, before pacing
+	int64_t frameEndQpc;   // hook exit, handed back to the game
+	int32_t elapsedUs;     // since the previous frame on this callsite returned
+	int32_t targetUs;      // frame length the deadline was built from
+	int32_t blockedUs;     // part of the wait spent in Sleep/SwitchToThread/timer waits
+	int32_t spinUs;        // part of the wait spent busy-waiting
+	uint8_t steps;         // speedMultiplier given to the game for this frame
+	FrameTimerCallsite callsite;
+	FrameTimerMode mode;
+};
+
+// Starts the background aggregator when [Framerate] frame_telemetry is set. Later calls are ignored.
+void ConfigureFrameTelemetry(const FramerateConfig& config);
+
+// Game thread only. Copies the sample into a fixed ring without locking or allocating; drops it if the ring is full.
+void RecordFrameSample(const FrameSample& sample);
+
+// Writes ToyStory2Fix.frametimes.csv next to the log. Only call this at process exit (DLL_PROCESS_DETACH with a
+// non-null lpReserved), when the aggregator thread has already been terminated.
+void FlushFrameTelemetry();
+} // namespace ts2fix
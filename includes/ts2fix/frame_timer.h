@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ts2fix/config.h"
+#include "ts2fix/frame_timer_core.h"
 
 #include <cstdint>
 
@@ -12,7 +13,6 @@ void InitializeFrameTimerModes();
 
 void ApplyRefreshRate(uint32_t refreshRate);
 uint32_t GetDesktopRefreshRate();
-uint32_t GetProcessWindowRefreshRate();
 bool IsStartupGuardActive();
 
 int __cdecl FrameTimerHook(int a1);
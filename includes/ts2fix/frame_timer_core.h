@@ -0,0 +1,134 @@
+#pragma once
+
+// The frame-timer state machine without Windows or the runtime context, so tools/frame_timer_replay can drive it with
+// a virtual clock. frame_timer.cpp supplies the real environment.
+
+#include <cstdint>
+
+namespace ts2fix
+{
+constexpr int kGameplayFrameTimeUs = 16667;
+
+enum class FrameTimerCallsite : uint8_t
+{
+	Unknown = 0,
+	Gameplay,
+	Frontend,
+	Menu,
+	Count
+};
+
+enum class FrameTimerMode : uint8_t
+{
+	LegacyPassthrough = 0,
+	CustomSafe60,
+	CustomZeroStep
+};
+
+const char* GetFrameTimerCallsiteName(FrameTimerCallsite callsite);
+const char* GetFrameTimerModeName(FrameTimerMode mode);
+
+// Where the time spent waiting for a frame deadline went.
+struct PacingWaitSplit
+{
+	int64_t blockedUs = 0; // inside Sleep, SwitchToThread or a timer wait
+	int64_t spinUs = 0;    // busy-waiting
+};
+
+struct FrameTimerState
+{
+	FrameTimerMode mode = FrameTimerMode::LegacyPassthrough;
+	int64_t previousQpc = 0;       // end of the previous frame
+	int64_t previousStartQpc = 0;  // start of the previous frame
+	int64_t nextFrameDeadlineQpc = 0;
+	int64_t simulationAccumulatorUs = 0;
+	uint32_t consecutiveZeroFrames = 0;
+	uint32_t framesSinceNonZero = 0;
+	uint32_t modeSwitchCount = 0;
+};
+
+// Inputs taken from the config and the runtime context on every frame.
+struct FrameTimerTuning
+{
+	int targetFrameTimeUs = kGameplayFrameTimeUs;
+	bool zeroSpeedSafetyReady = false;
+	bool autoFallbackTo60 = true;
+	int backgroundFrameTimeUs = 0; // background_fps as a frame time, 0 when off
+};
+
+// Everything the state machine reads from or does to the outside world.
+class FrameTimerEnvironment
+{
+public:
+	virtual ~FrameTimerEnvironment() = default;
+
+	// QueryPerformanceCounter and its frequency.
+	virtual int64_t QueryCounter() = 0;
+	virtual int64_t GetCounterFrequency() = 0;
+
+	// Called once per paced frame with its first counter reading, before any waiting.
+	virtual void BeginFrame(int64_t currentQpc) = 0;
+
+	// Blocks until QueryCounter() reaches deadlineQpc.
+	virtual PacingWaitSplit WaitForDeadline(int64_t deadlineQpc, int pacingFrameTimeUs) = 0;
+
+	// Lets the environment move a frame deadline, e.g. onto the display's vblank phase. gameWorkUs is how long the game
+	// ran between the previous frame's end and this one's start.
+	virtual int64_t AlignDeadline(int64_t deadlineQpc, int64_t frameDurationQpc, int64_t gameWorkUs)
+	{
+		(void)frameDurationQpc;
+		(void)gameWorkUs;
+		return deadlineQpc;
+	}
+
+	// Millisecond clock handed back to the game as the frame timer's return value.
+	virtual uint32_t GetTimeMs(int64_t currentQpc) = 0;
+
+	virtual bool IsStartupGuardActive() = 0;
+
+	// Whether the game window has lost focus or is minimized.
+	virtual bool IsGameInBackground() = 0;
+
+	// Called when ApplyBackgroundCap starts or stops capping the frame rate.
+	virtual void OnBackgroundChanged(bool background, int backgroundFrameTimeUs)
+	{
+		(void)background;
+		(void)backgroundFrameTimeUs;
+	}
+
+	virtual void OnModeChanged(FrameTimerCallsite callsite, FrameTimerMode oldMode, const FrameTimerState& state, const char* reason) = 0;
+
+	// The game's speedMultiplier and isDemoMode globals.
+	virtual uint32_t* GetSpeedMultiplier() = 0;
+	virtual bool* GetIsDemoMode() = 0;
+};
+
+// What one paced frame did, for telemetry and the replay tool.
+struct FrameTimerFrame
+{
+	int64_t frameStartQpc = 0;   // first counter reading, before pacing
+	int64_t frameEndQpc = 0;     // after pacing, handed back to the game
+	int64_t previousEndQpc = 0;  // frameEndQpc of the previous frame on this callsite
+	int64_t deadlineQpc = 0;
+	int64_t elapsedUs = 0;       // previousEndQpc to frameStartQpc
+	int64_t intervalUs = 0;      // previous frameStartQpc to this one; what the simulation accumulator advances by
+	int pacingFrameTimeUs = 0;
+	int speedMultiplier = 0;
+	PacingWaitSplit wait = {};
+	uint32_t timeMs = 0;
+};
+
+void ResetFrameTimerState(FrameTimerState& state);
+void SetFrameTimerMode(FrameTimerEnvironment& environment, FrameTimerCallsite callsite, FrameTimerState& state,
+	FrameTimerMode newMode, const char* reason);
+FrameTimerMode GetPreferredGameplayMode(const FrameTimerTuning& tuning);
+
+// While the game is in the background, raises tuning.targetFrameTimeUs to tuning.backgroundFrameTimeUs. inBackground
+// carries the last answer between frames so changes are reported once.
+void ApplyBackgroundCap(FrameTimerEnvironment& environment, FrameTimerTuning& tuning, bool& inBackground);
+
+// One call of the hooked frame timer in a custom mode: picks the simulation steps for this frame, writes them to
+// speedMultiplier, falls back to a safer mode on anomalies and waits for the frame deadline.
+FrameTimerFrame RunFrameTimerFrame(FrameTimerEnvironment& environment, const FrameTimerTuning& tuning,
+	FrameTimerCallsite callsite, FrameTimerState& state, bool allowZeroStepSimulation);
+} // namespace ts2fix
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include <cstdint>
+
+namespace ts2fix
+{
+// Finds the game's top-level window and subclasses it, so display-mode changes, moves to another monitor and focus
+// changes arrive as window messages instead of being polled. Cheap to call every frame: until the window exists it is
+// looked for a few times a second, afterwards the call returns immediately. The window is looked for again if the game
+// destroys it.
+void UpdateGameWindow();
+
+// nullptr until UpdateGameWindow has found the window.
+HWND GetGameWindow();
+
+// True while the game has lost focus (WM_ACTIVATEAPP) or its window is minimized. Read from the window's messages,
+// so it costs two loads.
+bool IsGameWindowInBackground();
+
+// Refresh rate of the monitor the game window is on, if it changed since the last call; 0 otherwise. Only tracked
+// while RuntimeContext::trackWindowRefreshRate is set.
+uint32_t TakeWindowRefreshRateChange();
+} // namespace ts2fix
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ts2fix
+{
+// FNV-1a hash of an executable file's PE headers (TimeDateStamp included) and its code sections' raw data.
+// Header-only so the host tools identify a build exactly the way the game does. Returns 0 for anything but a PE image.
+inline uint64_t HashExecutableFile(const uint8_t* file, std::size_t fileSize)
+{
+	constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+	constexpr uint64_t kFnvPrime = 1099511628211ULL;
+
+	auto hashBytes = [](uint64_t hash, const uint8_t* data, std::size_t size)
+	{
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			hash ^= data[i];
+			hash *= kFnvPrime;
+		}
+		return hash;
+	};
+
+	if (fileSize < sizeof(IMAGE_DOS_HEADER))
+		return 0;
+
+	const auto* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(file);
+	if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE || dosHeader->e_lfanew <= 0 ||
+		static_cast<std::size_t>(dosHeader->e_lfanew) + sizeof(IMAGE_NT_HEADERS) > fileSize)
+		return 0;
+
+	const auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(file + dosHeader->e_lfanew);
+	if (ntHeaders->Signature != IMAGE_NT_SIGNATURE)
+		return 0;
+
+	const std::size_t headerSize = std::min<std::size_t>(ntHeaders->OptionalHeader.SizeOfHeaders, fileSize);
+	uint64_t hash = hashBytes(kFnvOffsetBasis, file, headerSize);
+
+	const IMAGE_SECTION_HEADER* section = IMAGE_FIRST_SECTION(ntHeaders);
+	for (uint16_t i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i, ++section)
+	{
+		if ((section->Characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE)) == 0)
+			continue;
+
+		const std::size_t rawOffset = section->PointerToRawData;
+		if (rawOffset >= fileSize)
+			continue;
+
+		const std::size_t rawSize = std::min<std::size_t>(section->SizeOfRawData, fileSize - rawOffset);
+		hash = hashBytes(hash, file + rawOffset, rawSize);
+	}
+
+	return hash;
+}
+} // namespace ts2fix
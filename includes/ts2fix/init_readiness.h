@@ -0,0 +1,24 @@
+#pragma once
+
+#include "stdafx.h"
+
+namespace ts2fix
+{
+// Guards toy2.exe's code sections so the first instruction fetched from them (the unpacker handing over to the
+// game) wakes the delayed init thread. The game thread is held at that instruction until ReleaseReadinessWatcher.
+// Returns false if no section could be guarded.
+bool ArmReadinessWatcher();
+bool IsReadinessWatcherArmed();
+
+// Marks the calling thread as the one scanning the guarded code for the game, so its own reads are neither taken for
+// unpacking nor for the game starting. Call before its first scan.
+void SetReadinessScanThread();
+
+// Re-guards the pages the caller's scans opened, then waits up to timeoutMs for the watcher to fire. Returns true
+// once per firing.
+bool WaitForReadinessSignal(DWORD timeoutMs);
+
+// Lets a game thread held by the watcher continue, then removes the guards and the exception handler. Safe to call
+// when the watcher never fired or was never armed.
+void ReleaseReadinessWatcher();
+} // namespace ts2fix
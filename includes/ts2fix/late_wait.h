@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ts2fix/config.h"
+#include "ts2fix/frame_timer_core.h"
+
+#include <cstdint>
+
+namespace ts2fix
+{
+// Latency mode: most of each gameplay frame's pacing wait moves from the frame-timer callsite to just before the
+// game polls input, so input is read as late as the frame's work allows. The wait at the input poll ends when the
+// time the game has been taking from the poll to the next frame-timer call is left; the frame timer keeps its own
+// deadline and only waits out the residual.
+//
+// The input poll is found through [Framerate] input_poll_call, since no signature for it ships with the fix. Does
+// nothing unless [Framerate] late_wait is set and the call is found.
+bool InstallLateWaitHook(const FramerateConfig& config);
+
+// Called by the frame-timer hook after every paced gameplay frame: measures the time since the input poll and arms
+// the wait before the next one.
+void OnLateWaitFrame(const FrameTimerFrame& frame);
+} // namespace ts2fix
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ts2fix/frame_timer.h"
+#include "ts2fix/live_metrics_layout.h"
+
+#include <cstdint>
+
+namespace ts2fix
+{
+// Creates (or joins, when the other module got there first) this process's metrics block and marks the caller as a
+// publisher. The publish calls below do nothing until this succeeds.
+bool OpenLiveMetrics(uint32_t publisherBit);
+
+// Game thread only; a couple of stores and two interlocked increments each.
+void PublishFrameTimerCall(FrameTimerCallsite callsite);
+void PublishFrameTimerMode(FrameTimerCallsite callsite, FrameTimerMode mode, uint32_t modeSwitches);
+void PublishFrameTime(FrameTimerCallsite callsite, int64_t frameEndQpc, uint32_t frameUs);
+void PublishRefreshTarget(uint32_t refreshHz, int targetFrameTimeUs);
+} // namespace ts2fix
@@ -0,0 +1,58 @@
+#pragma once
+
+// Layout of the shared-memory metrics block. Kept free of other ts2fix headers so outside readers (tools/metrics_reader,
+// ops scripts) can include it on its own. Bump kLiveMetricsVersion on any layout change.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace ts2fix
+{
+constexpr uint32_t kLiveMetricsVersion = 1;
+constexpr uint32_t kLiveMetricsCallsites = 4;       // FrameTimerCallsite::Count
+constexpr uint32_t kLiveMetricsFrameHistory = 240;  // two seconds at 120 Hz
+
+// Bits in LiveMetricsBlock::publishers.
+constexpr uint32_t kLiveMetricsPublisherAsi = 1u << 0;
+constexpr uint32_t kLiveMetricsPublisherWrapper = 1u << 1;
+
+struct LiveCallsiteMetrics
+{
+	uint32_t mode;         // FrameTimerMode
+	uint32_t modeSwitches;
+	uint64_t hookCalls;    // every frame-timer call from this callsite, passthrough included
+	uint64_t pacedFrames;  // calls that ran the custom timer
+	uint32_t lastFrameUs;  // hook exit to hook exit
+	uint32_t reserved;
+};
+
+// Writers bump sequence to an odd value, update the block, then bump it back to even. Readers copy the block and retry
+// when sequence was odd or changed during the copy.
+struct LiveMetricsBlock
+{
+	uint32_t version;
+	uint32_t size;
+	uint32_t processId;
+	uint32_t publishers;
+	volatile uint32_t sequence;
+	uint32_t targetRefreshHz;
+	int32_t targetFrameTimeUs;
+	uint32_t reserved;
+	int64_t qpcFrequency;
+	int64_t lastUpdateQpc;
+	LiveCallsiteMetrics callsites[kLiveMetricsCallsites];
+
+	// Ring of the most recent paced frames; frameCount is the total ever written, so the newest entry is at
+	// (frameCount - 1) % kLiveMetricsFrameHistory.
+	uint64_t frameCount;
+	uint32_t frameTimesUs[kLiveMetricsFrameHistory];
+	uint8_t frameCallsites[kLiveMetricsFrameHistory];
+};
+
+// "Local\ToyStory2Fix.Metrics.<pid>", one block per game process.
+inline void FormatLiveMetricsName(char* buffer, std::size_t size, uint32_t processId)
+{
+	std::snprintf(buffer, size, "Local\\ToyStory2Fix.Metrics.%u", processId);
+}
+} // namespace ts2fix
@@ -1,10 +1,116 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Compile-time floor for TS2FIX_LOG_DIAGNOSTIC. Builds made with TS2FIX_LOG_MIN_LEVEL set to TS2FIX_LOG_LEVEL_INFO
+// (premake5 --strip-diagnostics) drop diagnostic calls, argument evaluation included; [Framerate] diagnostics then
+// has nothing left to turn on.
+#define TS2FIX_LOG_LEVEL_DIAGNOSTIC 0
+#define TS2FIX_LOG_LEVEL_INFO 1
+
+#ifndef TS2FIX_LOG_MIN_LEVEL
+#define TS2FIX_LOG_MIN_LEVEL TS2FIX_LOG_LEVEL_DIAGNOSTIC
+#endif
+
+// TS2FIX_LOG_DIAGNOSTIC(FrameTimer, "format", ...): a LogDiagnostic call that, while its subsystem is filtered out,
+// costs one load and a branch and doesn't evaluate its arguments.
+#define TS2FIX_LOG_DIAGNOSTIC(subsystem, ...) \
+	do \
+	{ \
+		if constexpr (TS2FIX_LOG_MIN_LEVEL <= TS2FIX_LOG_LEVEL_DIAGNOSTIC) \
+		{ \
+			if (::ts2fix::IsDiagnosticEnabled(::ts2fix::LogSubsystem::subsystem)) \
+				::ts2fix::LogDiagnostic(#subsystem, __VA_ARGS__); \
+		} \
+	} while (0)
+
+// TS2FIX_LOG_LIMITED(Subsystem, "format", ...): a Log call for messages that can fire in bursts (mode flapping, hooks
+// on every new COM object). Each call site writes a burst of 20 lines and then about one a second. Identical consecutive
+// lines are folded into a "last message repeated N times" line, written when the site logs something else, every
+// 10 seconds while the repeats last, and at exit.
+#define TS2FIX_LOG_LIMITED(subsystem, ...) \
+	do \
+	{ \
+		static ::ts2fix::LogRateLimit ts2fixLogRateLimit; \
+		::ts2fix::LogLimited(ts2fixLogRateLimit, #subsystem, __VA_ARGS__); \
+	} while (0)
+
 namespace ts2fix
 {
+// Subsystems [Framerate] diagnostic_subsystems can pick; each is one bit of the diagnostic mask. Diagnostics from
+// subsystems not listed here count as Other.
+enum class LogSubsystem : uint32_t
+{
+	FrameTimer,
+	Pacing,
+	LateWait,
+	Vblank,
+	Window,
+	Timer,
+	Threads,
+	Telemetry,
+	Metrics,
+	Safety,
+	ModernDepth,
+	Other,
+	Count,
+};
+
+namespace detail
+{
+// Bit per LogSubsystem; zero while diagnostics are off.
+extern std::atomic<uint32_t> g_diagnosticMask;
+} // namespace detail
+
+inline bool IsDiagnosticEnabled(LogSubsystem subsystem)
+{
+	return (detail::g_diagnosticMask.load(std::memory_order_relaxed) & (1u << static_cast<uint32_t>(subsystem))) != 0;
+}
+
 void SetDiagnosticsEnabled(bool enabled);
 bool IsDiagnosticsEnabled();
 
+// [Framerate] diagnostic_subsystems: comma-separated LogSubsystem names; empty or "all" keeps every subsystem.
+void SetDiagnosticSubsystems(const std::string& list);
+
+// With diagnostics on, writes LogDiagnostic calls to a binary trace (<module>.trace next to the log) instead of the
+// log: the call site's format is stored once, each call only records its format ID, a timestamp and the raw arguments.
+// tools/trace_decoder turns the file back into text or CSV. Formats the trace can't carry are still logged as text.
+void SetDiagnosticTraceEnabled(bool enabled);
+
+// Directory that holds ToyStory2Fix.log (with trailing separator); empty if no log file could be opened.
+std::string GetLogDirectory();
+
 void Log(const char* subsystem, const char* format, ...);
+
+// Prefer TS2FIX_LOG_DIAGNOSTIC on hot paths; this checks the subsystem by name after the arguments are evaluated.
 void LogDiagnostic(const char* subsystem, const char* format, ...);
+
+// State of one TS2FIX_LOG_LIMITED call site.
+struct LogRateLimit
+{
+	std::mutex mutex;
+	LogRateLimit* next = nullptr; // every site that has logged, for FlushLog
+	const char* subsystem = nullptr;
+	uint64_t refillMs = 0;
+	uint32_t tokens = 0;
+	uint32_t lastHash = 0;
+	uint32_t repeats = 0;         // identical lines since the last one written
+	uint64_t firstRepeatMs = 0;
+	uint32_t suppressed = 0;      // other lines the token bucket turned away
+};
+
+void LogLimited(LogRateLimit& limit, const char* subsystem, const char* format, ...);
+
+// Lines are written by a background thread a few times a second. Wakes it and waits (briefly, bounded) until everything
+// logged so far is written. An unhandled exception flushes on its own. Pending TS2FIX_LOG_LIMITED summaries are
+// written first.
+void FlushLog();
+
+// FlushLog for DLL_PROCESS_DETACH at process exit (lpReserved != nullptr) only: no other thread runs there, so the
+// calling thread takes the queue over from the writer, which may have been killed mid-write.
+void FlushLogAtProcessExit();
 } // namespace ts2fix
@@ -5,7 +5,22 @@
 
 namespace ts2fix
 {
+enum class CallsiteKind : uint8_t
+{
+	RelativeCall, // E8 rel32
+	RelativeJump, // E9 rel32
+	IndirectCall  // FF 15 [abs32]; the target is the pointer slot, usually an IAT entry
+};
+
 uintptr_t ResolveRelativeCall(uint8_t* callInstruction);
+
+// Queries a target->callsite index built once over every code section on first use.
+// Results are in address order and are re-decoded on lookup, so callsites already redirected are skipped.
+std::vector<uint8_t*> FindCallsitesToTarget(uintptr_t targetAddress, CallsiteKind kind);
 std::vector<uint8_t*> FindDirectCallsToTarget(uintptr_t targetAddress);
 int GetImmediatePushArgBeforeCall(uint8_t* callInstruction);
+
+// Resolves every install-time signature in one pass so the installers' own lookups don't rescan. saveCache refreshes
+// the signature cache after a scan; only the ASI's pass, which runs before any patch is applied, may set it.
+void PrefetchSignatures(bool saveCache);
 } // namespace ts2fix
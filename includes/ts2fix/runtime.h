@@ -33,7 +33,7 @@ struct RuntimeContext
 	int framerateFactor = 0;
 	int targetFrameTimeUs = 16667;
 
-	bool refreshRateProbePending = false;
+	bool trackWindowRefreshRate = false; // follow the game window's monitor instead of a fixed rate
 	bool zeroSpeedSafetyReady = false;
 	uint32_t targetRefreshRateOverride = 0;
 	ULONGLONG framerateInitTickMs = 0;
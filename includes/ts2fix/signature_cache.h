@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ts2fix
+{
+// FNV-1a hash of toy2.exe's PE headers and code sections as stored on disk, so it is unaffected by
+// patches already applied in memory. Returns 0 if the executable couldn't be read.
+uint64_t GetExecutableFingerprint();
+
+// Publishes pattern hints from the cache file next to ToyStory2Fix.log when it was written for the
+// same executable fingerprint. Returns the number of entries loaded.
+std::size_t LoadSignatureCache();
+
+// Writes the current hints. Only call this from a pass that ran before anything was patched: signatures whose bytes a
+// patch has overwritten no longer match, and their hints would be lost until the cache is next rewritten.
+void SaveSignatureCache();
+} // namespace ts2fix
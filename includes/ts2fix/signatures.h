@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Hooking.Patterns.h"
+
+namespace ts2fix
+{
+namespace signatures
+{
+// Parsed at compile time; a malformed signature fails the build.
+
+// Present once the executable has been unpacked; Init waits for it before installing anything.
+inline constexpr auto kInitReady = hook::make_pattern("03 D1 2B D7 85 D2 7E 09 52 E8 ? ? ? ?");
+
+inline constexpr auto kSpeedMultiplier = hook::make_pattern("8B 0D ? ? ? ? 2B F1 3B");
+inline constexpr auto kIsDemoMode = hook::make_pattern("39 3D ? ? ? ? 75 27");
+inline constexpr auto kMenuFrameTimerCall = hook::make_pattern("C7 05 ? ? ? ? 00 00 00 00 E8 ? ? ? ? E8 ? ? ? ? 33");
+inline constexpr auto kGameplayFrameTimerCall = hook::make_pattern("83 C4 08 6A 01 E8 ? ? ? ?");
+inline constexpr auto kFrontendFrameTimerCall = hook::make_pattern("E8 ? ? ? ? 6A 00 E8 ? ? ? ? 6A 01 E8 ? ? ? ? 83 C4");
+
+inline constexpr auto kSafetyMultiply = hook::make_pattern(
+	"8B 46 68 8B 56 70 0F AF 05 ? ? ? ? 89 46 68 8B 0D ? ? ? ? 0F AF 4E 6C 89 4E 6C 0F AF 15 ? ? ? ?");
+inline constexpr auto kSafetyDivide = hook::make_pattern(
+	"8B 46 68 83 C4 08 99 F7 3D ? ? ? ? 89 46 68 8B 46 6C 99 F7 3D ? ? ? ? 89 46 6C 8B 46 70 99 F7 3D ? ? ? ?");
+inline constexpr auto kSafetyMenuDivide = hook::make_pattern("B8 1E 00 00 00 53 99 F7 3D ? ? ? ? 56 57");
+inline constexpr auto kSafetyRenderDelta = hook::make_pattern(
+	"8B 0D ? ? ? ? B8 B7 60 0B B6 C1 E1 10 F7 E9 03 D1 C1 FA 08 8B C2 C1 E8 1F 03 D0 52 E8 ? ? ? ? 83 C4 0C");
+inline constexpr auto kSafetyRenderMotionA = hook::make_pattern(
+	"8B C1 2B C2 0F AF 05 ? ? ? ? 99 83 E2 0F 03 C2 C1 F8 04 2B C8 89 4F 04 8B 4F 08 8B 15 ? ? ? ? 8B C1 2B C2 0F AF 05 ? ? ? ? 99 83 E2 0F");
+inline constexpr auto kSafetyRenderMotionB = hook::make_pattern("8B 46 6C 0F AF 05 ? ? ? ? 99 83 E2 0F 03 C2 C1 F8 04 66 01 46 0E");
+inline constexpr auto kSafetyRenderMotionC = hook::make_pattern("C1 F8 03 0F AF 05 ? ? ? ? 99 2B C2 8B D0 66 8B 45 0E D1 FA 66 2B C2");
+inline constexpr auto kSafetyRenderMotionD = hook::make_pattern("8B D1 0F AF 15 ? ? ? ? 03 C2 8B 15 ? ? ? ? 3B C2");
+inline constexpr auto kSafetyRenderMotionE = hook::make_pattern("33 C0 8A C1 8B 54 24 ? D1 E8 83 C0 05 83 C4 10 0F AF 05 ? ? ? ? 03 D0 83 FA 10");
+inline constexpr auto kSafetyRenderMotionF = hook::make_pattern("33 C0 56 A0 ? ? ? ? 57 0F AF 05 ? ? ? ? 99 2B C2 33 FF 8B F0 D1 FE");
+inline constexpr auto kSafetyRenderMotionG = hook::make_pattern("A1 ? ? ? ? 66 8B 15 ? ? ? ? C1 F8 04 0F AF 05 ? ? ? ? 8B 0D ? ? ? ? 83 C4 28");
+
+inline constexpr auto kAllow32Bit = hook::make_pattern("74 0B 5E 5D B8 01 00 00 00");
+inline constexpr auto kIgnoreVRAM = hook::make_pattern("74 44 8B 8A 50 01 00 00 8B 91 64 03 00 00");
+inline constexpr auto kSkipSplash = hook::make_pattern("66 8B 3D ? ? ? ? 83 C4 1C");
+inline constexpr auto kRenderDistanceTable = hook::make_pattern(
+	"8B 86 ? ? ? ? 8B 8E ? ? ? ? 50 51 E8 ? ? ? ? 8B 96 ? ? ? ? 8B 86 ? ? ? ? 8B 8E ? ? ? ? 83 C4 08");
+
+inline constexpr auto kWidescreenCall = hook::make_pattern("8D 44 24 10 50 57 E8 ? ? ? ? 83");
+inline constexpr auto kWidescreenResolution = hook::make_pattern("8B 15 ? ? ? ? 89 4C 24 08 89 44 24 0C");
+inline constexpr auto kWidescreen3DScale = hook::make_pattern("C7 40 44 00 00 40 3F");
+
+inline constexpr auto kProjectionDepthRange = hook::make_pattern(
+	"C7 40 44 00 00 40 3F "
+	"8B 0D ? ? ? ? "
+	"C7 41 40 00 00 A0 3F "
+	"8B 15 ? ? ? ? "
+	"C7 42 4C 00 00 00 47 "
+	"A1 ? ? ? ? "
+	"C7 40 48 00 00 48 42");
+inline constexpr auto kDepthStateFunction = hook::make_pattern("66 83 3D ? ? ? ? 02 56 8B 35 ? ? ? ? 0F 85 ? ? ? ? A1 ? ? ? ? 85 C0");
+
+// Every signature looked up by the installers, resolved up front in a single pass by PrefetchSignatures.
+inline constexpr hook::pattern_view kInstallSignatures[] = {
+	kSpeedMultiplier,
+	kIsDemoMode,
+	kMenuFrameTimerCall,
+	kGameplayFrameTimerCall,
+	kFrontendFrameTimerCall,
+	kSafetyMultiply,
+	kSafetyDivide,
+	kSafetyMenuDivide,
+	kSafetyRenderDelta,
+	kSafetyRenderMotionA,
+	kSafetyRenderMotionB,
+	kSafetyRenderMotionC,
+	kSafetyRenderMotionD,
+	kSafetyRenderMotionE,
+	kSafetyRenderMotionF,
+	kSafetyRenderMotionG,
+	kAllow32Bit,
+	kIgnoreVRAM,
+	kSkipSplash,
+	kRenderDistanceTable,
+	kWidescreenCall,
+	kWidescreenResolution,
+	kWidescreen3DScale,
+	kProjectionDepthRange,
+	kDepthStateFunction,
+};
+} // namespace signatures
+} // namespace ts2fix
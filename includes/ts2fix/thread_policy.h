@@ -0,0 +1,18 @@
+#pragma once
+
+#include "ts2fix/config.h"
+
+namespace ts2fix
+{
+// Reads [Framerate] mmcss, game_thread_priority and core_affinity and, for core_affinity, sorts the cores this process
+// may run on into performance and efficiency cores. Only the first call does anything.
+void ConfigureThreadPolicy(const FramerateConfig& config);
+
+// Game thread, from the frame-timer hook: the first call registers the thread with MMCSS ("Games"), sets its priority
+// and keeps it on performance cores, as configured. Later calls return immediately.
+void ApplyGameThreadPolicy();
+
+// Keeps one of our background threads on efficiency cores when core_affinity is on and the CPU has them. Not for
+// threads whose wake-up latency matters.
+void ApplyHelperThreadPolicy(HANDLE thread);
+} // namespace ts2fix
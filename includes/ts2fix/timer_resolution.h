@@ -0,0 +1,18 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include <cstdint>
+
+namespace ts2fix
+{
+// Keeps timeBeginPeriod raised while a window of this process is in the foreground and not minimized, instead of
+// raising and dropping it around every frame. Cheap to call every frame; focus is only polled a few times a second.
+void UpdateTimerResolutionSession(int64_t currentQpc);
+
+// Whether the session currently holds the raised period.
+bool IsTimerResolutionRaised();
+
+// timeGetTime() as of currentQpc, extrapolated from the last focus poll instead of asked for every frame.
+DWORD GetSessionTimeMs(int64_t currentQpc);
+} // namespace ts2fix
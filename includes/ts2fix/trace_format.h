@@ -0,0 +1,75 @@
+#pragma once
+
+// Layout of the binary diagnostic trace ([Framerate] diagnostic_trace) and the printf-format walker shared by the
+// recorder and tools/trace_decoder. Kept free of Windows and other ts2fix headers so the decoder builds on Linux. Bump
+// kTraceVersion on any layout change.
+//
+// A trace file is a TraceFileHeader followed by records, all little-endian and unaligned. Every record starts with a
+// TraceRecordHeader whose size covers the whole record:
+//   TraceRecordType::Format: uint16 formatId, uint8 argCount, uint8 kinds[argCount], subsystem\0, format\0
+//   TraceRecordType::Event:  uint16 formatId, uint32 threadId, int64 qpc, then each argument as its kind says
+// A format's definition is written when it is first used, but an event from another thread can land before it; read
+// every definition before rendering events.
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ts2fix
+{
+constexpr char kTraceMagic[8] = { 'T', 'S', '2', 'T', 'R', 'A', 'C', 'E' };
+constexpr uint32_t kTraceVersion = 1;
+constexpr int kTraceMaxArgs = 12;
+constexpr std::size_t kTraceMaxStringBytes = 63; // longer %s arguments are cut
+
+struct TraceFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t pointerSize; // of the recording process
+	int64_t qpcFrequency;
+	int64_t startQpc;
+};
+
+enum class TraceRecordType : uint16_t
+{
+	Format = 1,
+	Event = 2,
+};
+
+struct TraceRecordHeader
+{
+	TraceRecordType type;
+	uint16_t size;
+};
+
+// How an argument is stored in an event: Int32 and Int64 as their bits, Double as an IEEE double, Pointer widened to 8
+// bytes, String as a length byte followed by that many characters.
+enum class TraceArgKind : uint8_t
+{
+	Int32 = 1,
+	Int64 = 2,
+	Double = 3,
+	Pointer = 4,
+	String = 5,
+};
+
+// One step through a printf format: the literal text up to the next conversion, then the conversion itself. A
+// conversion's arguments are listed in the order printf reads them ('*' width and precision first). "%%" comes back
+// as a conversion with no arguments.
+struct TraceConversion
+{
+	const char* literal;
+	std::size_t literalLength;
+	const char* spec;           // '%' through the conversion character; nullptr after the last conversion
+	std::size_t specLength;
+	char conversion;            // 'd', 's', 'f', ...
+	TraceArgKind kinds[3];      // sized for the recording process
+	int kindCount;              // -1 for conversions a trace can't carry (%n, unknown characters)
+};
+
+// Fills the next step and advances cursor; false once the format is used up.
+bool NextTraceConversion(const char*& cursor, TraceConversion& conversion);
+
+// Argument kinds of a whole format; -1 if it has a conversion a trace can't carry or more than maxKinds arguments.
+int ParseTraceArgKinds(const char* format, TraceArgKind* kinds, int maxKinds);
+} // namespace ts2fix
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ts2fix/config.h"
+
+#include <cstdint>
+
+namespace ts2fix
+{
+// Blocks until the start of the next vertical blank. Returns false if the display can't report one.
+using VblankWaitFn = bool (*)(void* context);
+
+// Reads [Framerate] vblank_lock and vblank_margin_us.
+void ConfigureVblankClock(const FramerateConfig& config);
+bool IsVblankClockEnabled();
+
+// Starts the thread that timestamps every vblank through wait and feeds the phase-locked loop. The ddraw.dll wrapper
+// calls this once it has a DirectDraw object; without it, frame deadlines are never aligned. Later calls are ignored.
+bool StartVblankClock(VblankWaitFn wait, void* context);
+
+// Game thread only. Moves a frame deadline so the game's next frame, going by its recent work time, is ready just
+// before a vblank. Returns deadlineQpc unchanged until the loop is locked.
+int64_t AlignFrameDeadlineToVblank(int64_t deadlineQpc, int64_t frameDurationQpc, int64_t gameWorkUs);
+} // namespace ts2fix
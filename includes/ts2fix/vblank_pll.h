@@ -0,0 +1,42 @@
+#pragma once
+
+// Phase-locked estimate of the display's refresh period and vblank phase, built from vblank timestamps, and frame
+// deadline alignment against it. Portable like frame_timer_core, so tools/frame_timer_replay runs the same code.
+
+#include <cstdint>
+
+namespace ts2fix
+{
+struct VblankEstimate
+{
+	bool locked = false;
+	int64_t phaseQpc = 0;    // a recent vblank
+	double periodQpc = 0.0;  // refresh period in counter ticks
+};
+
+class VblankPll
+{
+public:
+	void Reset();
+
+	// One vblank timestamp. Missed vblanks in between are fine; samples far off the prediction are ignored, and a
+	// run of them restarts acquisition.
+	void AddSample(int64_t vblankQpc);
+
+	const VblankEstimate& GetEstimate() const
+	{
+		return m_estimate;
+	}
+
+private:
+	VblankEstimate m_estimate = {};
+	int64_t m_acquireStartQpc = 0;
+	uint32_t m_acquireSamples = 0;
+	uint32_t m_trackedSamples = 0;
+	uint32_t m_outliers = 0;
+};
+
+// Moves deadlineQpc by at most half a refresh so that leadQpc after it (the game's work plus a safety margin) lands
+// just before a vblank. Leaves it alone while the estimate isn't locked or the frame isn't a whole number of refreshes.
+int64_t AlignDeadlineToVblank(const VblankEstimate& estimate, int64_t deadlineQpc, int64_t frameDurationQpc, int64_t leadQpc);
+} // namespace ts2fix
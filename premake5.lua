@@ -1,3 +1,8 @@
+newoption {
+   trigger = "strip-diagnostics",
+   description = "Compile TS2FIX_LOG_DIAGNOSTIC calls out of the ASI and the wrapper"
+}
+
 workspace "ToyStory2Fix"
    configurations { "Release", "Debug" }
    platforms { "Win32" }
@@ -17,6 +22,9 @@ workspace "ToyStory2Fix"
       includedirs { "external/inireader" }
       -- dxguid provides DirectX IID/CLSID definitions without importing ddraw.dll.
       links { "winmm", "dxguid" }
+      if _OPTIONS["strip-diagnostics"] then
+         defines { "TS2FIX_LOG_MIN_LEVEL=TS2FIX_LOG_LEVEL_INFO" }
+      end
    end
 
    function applyversiondefines()
@@ -86,4 +94,55 @@ project "ToyStory2DepthWrapper"
    files { "wrapper_source/*.cpp", "wrapper_source/*.def" }
    files { "external/hooking/Hooking.Patterns.h", "external/hooking/Hooking.Patterns.cpp" }
    files { "includes/stdafx.h" }
-   files { "source/config.cpp", "source/frame_timer.cpp", "source/frame_timer_install.cpp", "source/logging.cpp", "source/pattern_utils.cpp", "source/runtime.cpp", "source/zero_speed_safety.cpp" }
+   files { "source/build_database.cpp", "source/config.cpp", "source/config_snapshot.cpp", "source/frame_pacing.cpp", "source/frame_telemetry.cpp", "source/frame_timer.cpp", "source/frame_timer_core.cpp", "source/frame_timer_install.cpp", "source/game_window.cpp", "source/late_wait.cpp", "source/live_metrics.cpp", "source/logging.cpp", "source/pattern_utils.cpp", "source/runtime.cpp", "source/signature_cache.cpp", "source/thread_policy.cpp", "source/timer_resolution.cpp", "source/trace_format.cpp", "source/vblank_clock.cpp", "source/vblank_pll.cpp", "source/zero_speed_safety.cpp" }
+
+project "MetricsReader"
+   kind "ConsoleApp"
+   language "C++"
+   characterset ("MBCS")
+   flags { "StaticRuntime" }
+   targetdir "build/bin"
+   includedirs { "includes" }
+   files { "includes/ts2fix/live_metrics_layout.h" }
+   files { "tools/metrics_reader/*.cpp" }
+
+-- Host-side tools. Only generated for gmake (Linux): premake5 gmake2 && make -C build SignatureAnalyzer FrameTimerReplay TraceDecoder
+if _ACTION ~= nil and _ACTION:find("^gmake") ~= nil then
+project "SignatureAnalyzer"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   architecture "x86_64"
+   removebuildoptions { "-std:c++17" }
+   targetdir "build/bin"
+   includedirs { "tools/host" }
+   includedirs { "includes" }
+   includedirs { "external/hooking" }
+   files { "tools/host/*.h" }
+   files { "tools/signature_analyzer/*.h", "tools/signature_analyzer/*.cpp" }
+   files { "external/hooking/Hooking.Patterns.h", "external/hooking/Hooking.Patterns.cpp" }
+   links { "pthread" }
+
+project "FrameTimerReplay"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   architecture "x86_64"
+   removebuildoptions { "-std:c++17" }
+   targetdir "build/bin"
+   includedirs { "includes" }
+   files { "includes/ts2fix/frame_timer_core.h", "source/frame_timer_core.cpp" }
+   files { "includes/ts2fix/vblank_pll.h", "source/vblank_pll.cpp" }
+   files { "tools/frame_timer_replay/*.cpp" }
+
+project "TraceDecoder"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++17"
+   architecture "x86_64"
+   removebuildoptions { "-std:c++17" }
+   targetdir "build/bin"
+   includedirs { "includes" }
+   files { "includes/ts2fix/trace_format.h", "source/trace_format.cpp" }
+   files { "tools/trace_decoder/*.cpp" }
+end
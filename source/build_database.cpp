@@ -0,0 +1,69 @@
+#include "stdafx.h"
+#include "ts2fix/build_database.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/signature_cache.h"
+#include "ts2fix/signatures.h"
+
+#include <cinttypes>
+#include <iterator>
+
+namespace
+{
+using namespace ts2fix;
+
+constexpr std::size_t kMaxKnownBuildOffsets = std::size(signatures::kInstallSignatures);
+
+struct KnownBuildOffset
+{
+	uint64_t signatureHash; // hook::pattern_view::hash of the signature
+	uint32_t rva;
+};
+
+struct KnownBuild
+{
+	uint64_t fingerprint; // GetExecutableFingerprint() of the release
+	const char* name;
+	KnownBuildOffset offsets[kMaxKnownBuildOffsets];
+};
+
+// One row per release, printed by `SignatureAnalyzer --build-row toy2.exe` run on that release's executable. Packed
+// executables have no signatures on disk and get no row; they keep using the scan and the signature cache.
+const KnownBuild kKnownBuilds[] = {
+	{ 0, nullptr, {} }, // end of table
+};
+} // namespace
+
+namespace ts2fix
+{
+const char* ApplyKnownBuildOffsets()
+{
+	const uint64_t fingerprint = GetExecutableFingerprint();
+	if (fingerprint == 0)
+		return nullptr;
+
+	const auto* imageBase = reinterpret_cast<const uint8_t*>(GetModuleHandle(nullptr));
+	const auto* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(imageBase);
+	const auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(imageBase + dosHeader->e_lfanew);
+	const uint32_t imageSize = ntHeaders->OptionalHeader.SizeOfImage;
+
+	for (const KnownBuild& build : kKnownBuilds)
+	{
+		if (build.name == nullptr || build.fingerprint != fingerprint)
+			continue;
+
+		std::size_t applied = 0;
+		for (const KnownBuildOffset& offset : build.offsets)
+		{
+			if (offset.signatureHash == 0 || offset.rva >= imageSize)
+				continue;
+			hook::pattern::hint(offset.signatureHash, reinterpret_cast<uintptr_t>(imageBase) + offset.rva);
+			++applied;
+		}
+
+		Log("Patterns", "Known build %s (fingerprint %016" PRIx64 "), %zu offsets applied.\n", build.name, fingerprint, applied);
+		return build.name;
+	}
+
+	return nullptr;
+}
+} // namespace ts2fix
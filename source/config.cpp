@@ -3,6 +3,8 @@
 #include "ts2fix/logging.h"
 
 #include <algorithm>
+#include <cctype>
+#include <string>
 
 namespace
 {
@@ -49,6 +51,34 @@ int ReadIntegerWithAlias(CIniReader& iniReader, const char* section, const char*
 	return defaultValue;
 }
 
+ts2fix::PacingBackend ReadPacingBackend(CIniReader& iniReader)
+{
+	std::string value = iniReader.ReadString("Framerate", "pacing_backend", std::string("auto"));
+	std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+
+	if (value == "sleep_yield")
+		return ts2fix::PacingBackend::SleepYield;
+	if (value == "waitable_timer")
+		return ts2fix::PacingBackend::WaitableTimer;
+	if (value != "auto")
+		ts2fix::Log("Config", "Unknown [Framerate]/pacing_backend '%s'; using auto.\n", value.c_str());
+	return ts2fix::PacingBackend::Auto;
+}
+
+ts2fix::GameThreadPriority ReadGameThreadPriority(CIniReader& iniReader)
+{
+	std::string value = iniReader.ReadString("Framerate", "game_thread_priority", std::string("default"));
+	std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+
+	if (value == "above_normal")
+		return ts2fix::GameThreadPriority::AboveNormal;
+	if (value == "highest")
+		return ts2fix::GameThreadPriority::Highest;
+	if (value != "default")
+		ts2fix::Log("Config", "Unknown [Framerate]/game_thread_priority '%s'; using default.\n", value.c_str());
+	return ts2fix::GameThreadPriority::Default;
+}
+
 float ReadFloatWithAlias(CIniReader& iniReader, const char* section, const char* key, float defaultValue, const char* legacyKey)
 {
 	if (HasKey(iniReader, section, key))
@@ -72,6 +102,8 @@ Config LoadConfig(CIniReader& iniReader)
 
 	config.framerate.enabled = ReadBooleanWithAlias(iniReader, "Framerate", "enabled", true, "FixFramerate");
 	config.framerate.diagnostics = ReadBooleanWithAlias(iniReader, "Framerate", "diagnostics", false, "FramerateDiagnostics");
+	config.framerate.diagnosticTrace = ReadBooleanWithAlias(iniReader, "Framerate", "diagnostic_trace", false, nullptr);
+	config.framerate.diagnosticSubsystems = iniReader.ReadString("Framerate", "diagnostic_subsystems", std::string());
 	config.framerate.nativeRefreshRate = ReadBooleanWithAlias(iniReader, "Framerate", "native_refresh", false, "NativeRefreshRate");
 	config.framerate.targetRefreshRate = std::max(0, ReadIntegerWithAlias(iniReader, "Framerate", "target_refresh_rate", 0, "TargetRefreshRate"));
 	config.framerate.autoFallbackTo60 = ReadBooleanWithAlias(iniReader, "Framerate", "auto_fallback_60", true, "AutoFallbackTo60");
@@ -81,9 +113,36 @@ Config LoadConfig(CIniReader& iniReader)
 		iniReader, "Framerate", "frontend_custom_timing", false, "AllowFrontendCustomTiming");
 	config.framerate.frontendZeroStep = ReadBooleanWithAlias(
 		iniReader, "Framerate", "frontend_zero_step", false, "AllowFrontendZeroStep");
+	config.framerate.pacingBackend = ReadPacingBackend(iniReader);
+	config.framerate.pacingSpinUs = static_cast<uint32_t>(std::clamp(ReadIntegerWithAlias(iniReader, "Framerate", "pacing_spin_us", 200, nullptr), 0, 2000));
+	config.framerate.frameTelemetry = ReadBooleanWithAlias(iniReader, "Framerate", "frame_telemetry", false, nullptr);
+	config.framerate.liveMetrics = ReadBooleanWithAlias(iniReader, "Framerate", "live_metrics", true, nullptr);
+	config.framerate.vblankLock = ReadBooleanWithAlias(iniReader, "Framerate", "vblank_lock", false, nullptr);
+	config.framerate.vblankMarginUs = static_cast<uint32_t>(std::clamp(ReadIntegerWithAlias(iniReader, "Framerate", "vblank_margin_us", 1500, nullptr), 0, 5000));
+	config.framerate.lateWait = ReadBooleanWithAlias(iniReader, "Framerate", "late_wait", false, nullptr);
+	config.framerate.inputPollCall = iniReader.ReadString("Framerate", "input_poll_call", std::string());
+	config.framerate.inputPollCallOffset = std::max(0, ReadIntegerWithAlias(iniReader, "Framerate", "input_poll_call_offset", 0, nullptr));
+	config.framerate.lateWaitResidualUs = static_cast<uint32_t>(std::clamp(ReadIntegerWithAlias(iniReader, "Framerate", "late_wait_residual_us", 500, nullptr), 0, 5000));
+	config.framerate.mmcss = ReadBooleanWithAlias(iniReader, "Framerate", "mmcss", false, nullptr);
+	config.framerate.gameThreadPriority = ReadGameThreadPriority(iniReader);
+	config.framerate.coreAffinity = ReadBooleanWithAlias(iniReader, "Framerate", "core_affinity", false, nullptr);
+	// Below 20 FPS a frame needs more than the three simulation steps speedMultiplier allows and the game slows down.
+	const int backgroundFps = ReadIntegerWithAlias(iniReader, "Framerate", "background_fps", 30, nullptr);
+	config.framerate.backgroundFps = backgroundFps > 0 ? static_cast<uint32_t>(std::clamp(backgroundFps, 20, 60)) : 0;
 
 	config.rendering.modernDepthPipeline = ReadBooleanWithAlias(
 		iniReader, "Rendering", "modern_depth_pipeline", true, "ModernDepthPipeline");
+	config.rendering.modernDepthReversedZ = ReadBooleanWithAlias(iniReader, "Rendering", "modern_depth_reversed_z", false, nullptr);
+	config.rendering.modernDepthDynamicNear = ReadBooleanWithAlias(iniReader, "Rendering", "modern_depth_dynamic_near", true, nullptr);
+	config.rendering.modernDepthNearMin = std::max(0.1f, ReadFloatWithAlias(iniReader, "Rendering", "modern_depth_near_min", 1.0f, nullptr));
+	config.rendering.modernDepthNearMax = std::max(
+		config.rendering.modernDepthNearMin, ReadFloatWithAlias(iniReader, "Rendering", "modern_depth_near_max", 300.0f, nullptr));
+	config.rendering.modernDepthFar = std::max(
+		config.rendering.modernDepthNearMin + 1.0f, ReadFloatWithAlias(iniReader, "Rendering", "modern_depth_far", 20000.0f, nullptr));
+	config.rendering.modernDepthFormat = iniReader.ReadString("Rendering", "modern_depth_format", std::string("auto"));
+	std::transform(config.rendering.modernDepthFormat.begin(), config.rendering.modernDepthFormat.end(),
+		config.rendering.modernDepthFormat.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+	config.rendering.modernDepthDebugOverlay = ReadBooleanWithAlias(iniReader, "Rendering", "modern_depth_debug_overlay", false, nullptr);
 	config.rendering.widescreen = ReadBooleanWithAlias(iniReader, "Rendering", "widescreen", true, "Widescreen");
 	config.rendering.zBufferFix = ReadBooleanWithAlias(iniReader, "Rendering", "zbuffer_fix", true, "FixZBuffer");
 	config.rendering.zBufferNearPlane = std::max(
@@ -102,6 +161,10 @@ Config LoadConfig(CIniReader& iniReader)
 	config.compatibility.ignoreVRAM = ReadBooleanWithAlias(iniReader, "Compatibility", "ignore_vram", true, "IgnoreVRAM");
 	config.compatibility.skipSplash = ReadBooleanWithAlias(iniReader, "Compatibility", "skip_splash", true, "SkipSplash");
 
+	config.advanced.scanThreads = static_cast<uint32_t>(
+		std::max(0, ReadIntegerWithAlias(iniReader, "Advanced", "scan_threads", 0, nullptr)));
+	config.advanced.readinessWatch = ReadBooleanWithAlias(iniReader, "Advanced", "readiness_watch", true, nullptr);
+
 	if (!config.framerate.frontendCustomTiming && config.framerate.frontendZeroStep)
 	{
 		config.framerate.frontendZeroStep = false;
@@ -0,0 +1,178 @@
+#include "stdafx.h"
+#include "ts2fix/config_snapshot.h"
+#include "ts2fix/logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace
+{
+// Bump on any change to ConfigSnapshot.
+constexpr uint32_t kConfigSnapshotVersion = 2;
+constexpr uint32_t kMaxIniBytes = 64 * 1024;
+constexpr uint32_t kIniTooLarge = UINT32_MAX;
+constexpr DWORD kPublishTimeoutMs = 1000;
+
+constexpr LONG kSnapshotEmpty = 0;
+constexpr LONG kSnapshotWriting = 1;
+constexpr LONG kSnapshotReady = 2;
+
+// Contents of the named mapping, written once by the first module to start. Only plain bytes cross over: the ASI and
+// the wrapper each have their own CRT and heap and may be built differently, so each parses the text itself.
+struct ConfigSnapshot
+{
+	volatile LONG state;
+	uint32_t version;
+	uint32_t textLength;   // kIniTooLarge if the file didn't fit; readers then open iniPath themselves
+	char iniPath[MAX_PATH];
+	char text[kMaxIniBytes];
+};
+static_assert(std::is_trivially_copyable_v<ConfigSnapshot>);
+
+std::once_flag g_snapshotOnce;
+ts2fix::Config g_config = {};
+
+bool FileExists(const std::string& path)
+{
+	const DWORD attrs = GetFileAttributesA(path.c_str());
+	return attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY) == 0;
+}
+
+// scripts\ToyStory2Fix.ini below this module, else ToyStory2Fix.ini beside it: the ASI sits in scripts\ and finds the
+// second, the wrapper sits next to the game and finds the first.
+std::string ResolveIniPath()
+{
+	char modulePath[MAX_PATH] = {};
+	HMODULE module = nullptr;
+	if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			reinterpret_cast<LPCSTR>(&g_snapshotOnce), &module)
+		|| GetModuleFileNameA(module, modulePath, MAX_PATH) == 0)
+		return "ToyStory2Fix.ini";
+
+	std::string directory = modulePath;
+	directory = directory.substr(0, directory.find_last_of("\\/") + 1);
+
+	const std::string scriptsIni = directory + "scripts\\ToyStory2Fix.ini";
+	if (FileExists(scriptsIni))
+		return scriptsIni;
+	return directory + "ToyStory2Fix.ini";
+}
+
+// The file as CIniReader would read it (text mode), so parsing the copy gives what parsing the file does.
+std::string ReadIniText(const std::string& path)
+{
+	std::ifstream file(path, std::ios::in);
+	if (!file.is_open())
+		return {};
+
+	std::stringstream text;
+	text << file.rdbuf();
+	return text.str();
+}
+
+ts2fix::Config ParseIniText(const std::string& text)
+{
+	std::stringstream stream(text);
+	CIniReader iniReader(stream);
+	return ts2fix::LoadConfig(iniReader);
+}
+
+void ParseOwnIni(const char* reason)
+{
+	const std::string iniPath = ResolveIniPath();
+	g_config = ParseIniText(ReadIniText(iniPath));
+	ts2fix::Log("Config", "%sRead %s.\n", reason, iniPath.c_str());
+}
+
+void PublishIni(ConfigSnapshot* snapshot)
+{
+	const std::string iniPath = ResolveIniPath();
+	const std::string text = ReadIniText(iniPath);
+
+	std::snprintf(snapshot->iniPath, sizeof(snapshot->iniPath), "%s", iniPath.c_str());
+	snapshot->version = kConfigSnapshotVersion;
+	if (text.size() <= kMaxIniBytes)
+	{
+		std::memcpy(snapshot->text, text.data(), text.size());
+		snapshot->textLength = static_cast<uint32_t>(text.size());
+	}
+	else
+	{
+		snapshot->textLength = kIniTooLarge;
+	}
+	InterlockedExchange(&snapshot->state, kSnapshotReady);
+
+	g_config = ParseIniText(text);
+	ts2fix::Log("Config", "Read %s.\n", iniPath.c_str());
+}
+
+void AdoptIni(const ConfigSnapshot* snapshot)
+{
+	const DWORD start = GetTickCount();
+	while (InterlockedCompareExchange(const_cast<volatile LONG*>(&snapshot->state), kSnapshotReady, kSnapshotReady) != kSnapshotReady)
+	{
+		if (GetTickCount() - start >= kPublishTimeoutMs)
+		{
+			ParseOwnIni("The other module never finished sharing the config. ");
+			return;
+		}
+		Sleep(1);
+	}
+
+	if (snapshot->version != kConfigSnapshotVersion)
+	{
+		ParseOwnIni("The other module is from a different build. ");
+		return;
+	}
+
+	char iniPath[MAX_PATH] = {};
+	std::memcpy(iniPath, snapshot->iniPath, sizeof(iniPath) - 1);
+	if (snapshot->textLength == kIniTooLarge)
+	{
+		g_config = ParseIniText(ReadIniText(iniPath));
+		ts2fix::Log("Config", "Read %s (too large to share).\n", iniPath);
+		return;
+	}
+
+	g_config = ParseIniText(std::string(snapshot->text, std::min(snapshot->textLength, kMaxIniBytes)));
+	ts2fix::Log("Config", "Using the config the other module read from %s.\n", iniPath);
+}
+
+void InitializeSharedConfig()
+{
+	char name[64] = {};
+	std::snprintf(name, sizeof(name), "Local\\ToyStory2Fix.Config.%lu", GetCurrentProcessId());
+
+	// The mapping is never unmapped or closed: the other module may look for the snapshot at any time.
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(ConfigSnapshot), name);
+	auto* snapshot = mapping != nullptr
+		? static_cast<ConfigSnapshot*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ConfigSnapshot)))
+		: nullptr;
+	if (snapshot == nullptr)
+	{
+		ParseOwnIni("Could not share the config. ");
+		return;
+	}
+
+	// Both modules may start at once; the first to claim the snapshot writes it and the other waits for it.
+	if (InterlockedCompareExchange(&snapshot->state, kSnapshotWriting, kSnapshotEmpty) == kSnapshotEmpty)
+		PublishIni(snapshot);
+	else
+		AdoptIni(snapshot);
+}
+} // namespace
+
+namespace ts2fix
+{
+const Config& GetSharedConfig()
+{
+	std::call_once(g_snapshotOnce, InitializeSharedConfig);
+	return g_config;
+}
+} // namespace ts2fix
@@ -1,9 +1,16 @@
 #include "stdafx.h"
+#include "ts2fix/frame_telemetry.h"
 #include "ts2fix/init.h"
+#include "ts2fix/logging.h"
 
-BOOL APIENTRY DllMain(HMODULE /*hModule*/, DWORD reason, LPVOID /*lpReserved*/)
+BOOL APIENTRY DllMain(HMODULE /*hModule*/, DWORD reason, LPVOID lpReserved)
 {
 	if (reason == DLL_PROCESS_ATTACH)
 		ts2fix::Init(nullptr);
+	else if (reason == DLL_PROCESS_DETACH && lpReserved != nullptr)
+	{
+		ts2fix::FlushFrameTelemetry();
+		ts2fix::FlushLogAtProcessExit();
+	}
 	return TRUE;
 }
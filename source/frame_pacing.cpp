@@ -0,0 +1,380 @@
+#include "stdafx.h"
+#include "ts2fix/frame_pacing.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/runtime.h"
+#include "ts2fix/timer_resolution.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace
+{
+constexpr int64_t kStatsReportIntervalUs = 10000000;
+
+// Wake-up error model: margins are set so this share of waits still wakes before its deadline.
+constexpr uint32_t kTargetPermille = 990;
+constexpr uint32_t kMinModelSamples = 64;
+constexpr uint32_t kModelAgingSamples = 2048;
+constexpr int64_t kLateFrameThresholdUs = 250;
+
+// How far past the requested time a wait returned (for Sleep(0)/SwitchToThread: how long it took), in 25 us buckets.
+// Counts are halved every kModelAgingSamples so the model follows power-plan and load changes.
+class WakeErrorHistogram
+{
+public:
+	static constexpr int64_t kBucketUs = 25;
+	static constexpr std::size_t kBuckets = 400;
+
+	void Record(int64_t errorUs)
+	{
+		const std::size_t bucket = static_cast<std::size_t>(std::clamp<int64_t>(errorUs / kBucketUs, 0, kBuckets - 1));
+		m_counts[bucket] += 1;
+		m_total += 1;
+		if (m_total < kModelAgingSamples)
+			return;
+
+		m_total = 0;
+		for (uint32_t& count : m_counts)
+		{
+			count /= 2;
+			m_total += count;
+		}
+	}
+
+	// Upper edge of the bucket holding the given percentile, or fallbackUs until enough waits were seen.
+	int64_t Percentile(uint32_t permille, int64_t fallbackUs) const
+	{
+		if (m_total < kMinModelSamples)
+			return fallbackUs;
+
+		const uint64_t rank = (static_cast<uint64_t>(m_total) * permille + 999) / 1000;
+		uint64_t seen = 0;
+		for (std::size_t bucket = 0; bucket < kBuckets; ++bucket)
+		{
+			seen += m_counts[bucket];
+			if (seen >= rank)
+				return static_cast<int64_t>(bucket + 1) * kBucketUs;
+		}
+		return static_cast<int64_t>(kBuckets) * kBucketUs;
+	}
+
+private:
+	uint32_t m_counts[kBuckets] = {};
+	uint32_t m_total = 0;
+};
+
+// What each wait costs depends on the system timer period: with it released in the background a 1 ms Sleep
+// oversleeps by up to ~15.6 ms. Each period gets its own model so background frames don't skew foreground margins.
+struct WakeErrorModel
+{
+	WakeErrorHistogram sleepOvershoot;
+	WakeErrorHistogram yieldCost;
+	WakeErrorHistogram switchCost;
+	WakeErrorHistogram timerOvershoot;
+};
+
+struct PacingMargins
+{
+	int64_t sleepUs;
+	int64_t yieldUs;
+	int64_t spinUs;
+};
+
+struct PacingStats
+{
+	uint32_t frames = 0;
+	int64_t windowStartQpc = 0;
+	uint64_t windowStartThreadTime = 0; // 100 ns units, kernel + user
+	int64_t waitQpc = 0;
+	uint64_t waitCycles = 0;
+	uint32_t lateFrames = 0;
+};
+
+ts2fix::PacingBackend g_requestedBackend = ts2fix::PacingBackend::Auto;
+ts2fix::PacingBackend g_activeBackend = ts2fix::PacingBackend::SleepYield;
+bool g_backendResolved = false;
+int64_t g_spinUs = 200;
+HANDLE g_waitableTimer = nullptr;
+PacingStats g_stats = {};
+
+WakeErrorModel g_models[2]; // indexed by whether the raised timer period is held
+
+WakeErrorModel& GetWakeErrorModel()
+{
+	return g_models[ts2fix::IsTimerResolutionRaised() ? 1 : 0];
+}
+
+int64_t QpcToUs(int64_t qpc)
+{
+	return (qpc * 1000000) / ts2fix::GetRuntimeContext().performanceFrequency.QuadPart;
+}
+
+int64_t QueryQpc()
+{
+	LARGE_INTEGER currentTime = {};
+	QueryPerformanceCounter(&currentTime);
+	return currentTime.QuadPart;
+}
+
+uint64_t QueryThreadTime()
+{
+	FILETIME creationTime = {};
+	FILETIME exitTime = {};
+	FILETIME kernelTime = {};
+	FILETIME userTime = {};
+	if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return 0;
+
+	const uint64_t kernel = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+	const uint64_t user = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+	return kernel + user;
+}
+
+// Timers are created on the first paced frame, on the game thread that will wait on them.
+void ResolveBackend()
+{
+	g_backendResolved = true;
+	g_activeBackend = ts2fix::PacingBackend::SleepYield;
+	if (g_requestedBackend == ts2fix::PacingBackend::SleepYield)
+	{
+		ts2fix::Log("Pacing", "Using sleep/yield pacing.\n");
+		return;
+	}
+
+	// High-resolution timers (Windows 10 1803+) fire on time regardless of the system timer period.
+	g_waitableTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	const bool highResolution = g_waitableTimer != nullptr;
+	if (g_waitableTimer == nullptr && g_requestedBackend == ts2fix::PacingBackend::WaitableTimer)
+		g_waitableTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+
+	if (g_waitableTimer == nullptr)
+	{
+		ts2fix::Log("Pacing", "High-resolution waitable timers unavailable; using sleep/yield pacing.\n");
+		return;
+	}
+
+	g_activeBackend = ts2fix::PacingBackend::WaitableTimer;
+	ts2fix::Log("Pacing", "Using %s waitable-timer pacing with a %lld us spin.\n",
+		highResolution ? "high-resolution" : "standard", static_cast<long long>(g_spinUs));
+}
+
+// The original hand-tuned margins serve until the model has samples for this machine.
+PacingMargins GetSleepYieldMargins(int pacingFrameTimeUs)
+{
+	const bool highRefreshPacing = pacingFrameTimeUs <= 10000;
+	const int64_t defaultSleepUs = highRefreshPacing
+		? std::max<int64_t>(3500, pacingFrameTimeUs / 2)
+		: std::max<int64_t>(2000, pacingFrameTimeUs / 5);
+	const int64_t defaultYieldUs = highRefreshPacing
+		? std::max<int64_t>(1200, pacingFrameTimeUs / 6)
+		: std::max<int64_t>(800, pacingFrameTimeUs / 10);
+	const int64_t defaultSpinUs = highRefreshPacing ? 300 : 150;
+
+	// Spin once a SwitchToThread could outlast what's left, use SwitchToThread once a Sleep(0) could, and stop
+	// sleeping once a 1 ms Sleep's overshoot could. Each stage keeps the next one's margin in hand.
+	const WakeErrorModel& model = GetWakeErrorModel();
+	PacingMargins margins = {};
+	margins.spinUs = std::clamp<int64_t>(model.switchCost.Percentile(kTargetPermille, defaultSpinUs), 50, 2000);
+	margins.yieldUs = margins.spinUs + std::clamp<int64_t>(model.yieldCost.Percentile(kTargetPermille, defaultYieldUs - defaultSpinUs), 50, 4000);
+	margins.sleepUs = margins.yieldUs + std::clamp<int64_t>(model.sleepOvershoot.Percentile(kTargetPermille, defaultSleepUs - defaultYieldUs), 100, 8000);
+	return margins;
+}
+
+void WaitSleepYield(int64_t deadlineQpc, int pacingFrameTimeUs, int64_t& blockedQpc, int64_t& spinQpc)
+{
+	auto& runtime = ts2fix::GetRuntimeContext();
+	WakeErrorModel& wakeErrors = GetWakeErrorModel();
+	const PacingMargins margins = GetSleepYieldMargins(pacingFrameTimeUs);
+
+	runtime.sleepTime = 0;
+	int64_t currentQpc = QueryQpc();
+	for (;;)
+	{
+		const int64_t remainingUs = QpcToUs(deadlineQpc - currentQpc);
+		if (remainingUs <= 0)
+			break;
+
+		if (remainingUs <= margins.spinUs)
+		{
+			YieldProcessor();
+			const int64_t spunQpc = QueryQpc();
+			spinQpc += spunQpc - currentQpc;
+			currentQpc = spunQpc;
+			continue;
+		}
+
+		WakeErrorHistogram* model = nullptr;
+		int64_t requestedUs = 0;
+		const int candidateMs = static_cast<int>((remainingUs - margins.sleepUs) / 1000);
+		if (remainingUs > margins.sleepUs && candidateMs > 0)
+		{
+			runtime.sleepTime = candidateMs;
+			Sleep(runtime.sleepTime);
+			model = &wakeErrors.sleepOvershoot;
+			requestedUs = static_cast<int64_t>(candidateMs) * 1000;
+		}
+		else if (remainingUs > margins.yieldUs)
+		{
+			Sleep(0);
+			model = &wakeErrors.yieldCost;
+		}
+		else
+		{
+			SwitchToThread();
+			model = &wakeErrors.switchCost;
+		}
+
+		const int64_t wokeQpc = QueryQpc();
+		model->Record(QpcToUs(wokeQpc - currentQpc) - requestedUs);
+		blockedQpc += wokeQpc - currentQpc;
+		currentQpc = wokeQpc;
+	}
+}
+
+// Returns false if the timer could not be armed, leaving the rest of the wait to the caller.
+bool WaitWaitableTimer(int64_t deadlineQpc, int64_t& blockedQpc, int64_t& spinQpc)
+{
+	// The spin only has to cover how late the timer fires; pacing_spin_us caps it.
+	WakeErrorHistogram& timerOvershoot = GetWakeErrorModel().timerOvershoot;
+	const int64_t spinUs = std::clamp<int64_t>(timerOvershoot.Percentile(kTargetPermille, g_spinUs), 0, g_spinUs);
+
+	for (;;)
+	{
+		const int64_t armedQpc = QueryQpc();
+		const int64_t remainingUs = QpcToUs(deadlineQpc - armedQpc);
+		if (remainingUs <= spinUs)
+			break;
+
+		// Relative due time, in 100 ns units.
+		const int64_t requestedUs = remainingUs - spinUs;
+		LARGE_INTEGER dueTime = {};
+		dueTime.QuadPart = -requestedUs * 10;
+		if (!SetWaitableTimer(g_waitableTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+			return false;
+		WaitForSingleObject(g_waitableTimer, INFINITE);
+		const int64_t wokeQpc = QueryQpc();
+		timerOvershoot.Record(QpcToUs(wokeQpc - armedQpc) - requestedUs);
+		blockedQpc += wokeQpc - armedQpc;
+	}
+
+	// Whatever is left is at most the spin budget (less if the timer fired late).
+	const int64_t spinStartQpc = QueryQpc();
+	int64_t currentQpc = spinStartQpc;
+	while (currentQpc < deadlineQpc)
+	{
+		YieldProcessor();
+		currentQpc = QueryQpc();
+	}
+	spinQpc += currentQpc - spinStartQpc;
+	return true;
+}
+
+void RecordPacingStats(int64_t deadlineQpc, int pacingFrameTimeUs, int64_t waitStartQpc, uint64_t waitStartCycles)
+{
+	LARGE_INTEGER waitEnd = {};
+	QueryPerformanceCounter(&waitEnd);
+	ULONG64 waitEndCycles = 0;
+	QueryThreadCycleTime(GetCurrentThread(), &waitEndCycles);
+
+	if (g_stats.windowStartQpc == 0)
+	{
+		g_stats.windowStartQpc = waitEnd.QuadPart;
+		g_stats.windowStartThreadTime = QueryThreadTime();
+		return;
+	}
+
+	g_stats.frames += 1;
+	g_stats.waitQpc += waitEnd.QuadPart - waitStartQpc;
+	g_stats.waitCycles += waitEndCycles - waitStartCycles;
+	if (QpcToUs(waitEnd.QuadPart - deadlineQpc) > kLateFrameThresholdUs)
+		g_stats.lateFrames += 1;
+
+	const int64_t windowUs = QpcToUs(waitEnd.QuadPart - g_stats.windowStartQpc);
+	if (windowUs < kStatsReportIntervalUs)
+		return;
+
+	// Thread times tick at the scheduler quantum, so they're only meaningful summed over the whole window.
+	const uint64_t threadTime = QueryThreadTime();
+	const double frames = static_cast<double>(g_stats.frames);
+	TS2FIX_LOG_DIAGNOSTIC(Pacing, "%s: %u frames, wait %.0f us/frame (%.1f kcycles/frame), thread CPU %.0f us/frame (%.1f%% of wall time)\n",
+		ts2fix::GetPacingBackendName(), g_stats.frames,
+		static_cast<double>(QpcToUs(g_stats.waitQpc)) / frames,
+		static_cast<double>(g_stats.waitCycles) / frames / 1000.0,
+		static_cast<double>(threadTime - g_stats.windowStartThreadTime) / 10.0 / frames,
+		static_cast<double>(threadTime - g_stats.windowStartThreadTime) / 10.0 * 100.0 / static_cast<double>(windowUs));
+
+	const WakeErrorModel& model = GetWakeErrorModel();
+	if (g_activeBackend == ts2fix::PacingBackend::WaitableTimer)
+	{
+		TS2FIX_LOG_DIAGNOSTIC(Pacing, "learned spin %lld us (timer late p99 %lld us), %u frame(s) woke > %lld us late\n",
+			static_cast<long long>(std::min(model.timerOvershoot.Percentile(kTargetPermille, g_spinUs), g_spinUs)),
+			static_cast<long long>(model.timerOvershoot.Percentile(kTargetPermille, -1)), g_stats.lateFrames,
+			static_cast<long long>(kLateFrameThresholdUs));
+	}
+	else
+	{
+		// -1 = not enough samples yet, the default margin is in use.
+		const PacingMargins margins = GetSleepYieldMargins(pacingFrameTimeUs);
+		TS2FIX_LOG_DIAGNOSTIC(Pacing, "learned margins sleep/yield/spin %lld/%lld/%lld us (p99 Sleep overshoot %lld, Sleep(0) %lld, "
+			"SwitchToThread %lld us), %u frame(s) woke > %lld us late\n",
+			static_cast<long long>(margins.sleepUs), static_cast<long long>(margins.yieldUs), static_cast<long long>(margins.spinUs),
+			static_cast<long long>(model.sleepOvershoot.Percentile(kTargetPermille, -1)),
+			static_cast<long long>(model.yieldCost.Percentile(kTargetPermille, -1)),
+			static_cast<long long>(model.switchCost.Percentile(kTargetPermille, -1)), g_stats.lateFrames,
+			static_cast<long long>(kLateFrameThresholdUs));
+	}
+
+	g_stats = {};
+	g_stats.windowStartQpc = waitEnd.QuadPart;
+	g_stats.windowStartThreadTime = threadTime;
+}
+} // namespace
+
+namespace ts2fix
+{
+void ConfigureFramePacing(const FramerateConfig& config)
+{
+	g_requestedBackend = config.pacingBackend;
+	g_spinUs = static_cast<int64_t>(config.pacingSpinUs);
+}
+
+PacingWaitSplit WaitForFrameDeadline(int64_t deadlineQpc, int pacingFrameTimeUs)
+{
+	if (!g_backendResolved)
+		ResolveBackend();
+
+	const bool collectStats = TS2FIX_LOG_MIN_LEVEL <= TS2FIX_LOG_LEVEL_DIAGNOSTIC && IsDiagnosticEnabled(LogSubsystem::Pacing);
+	LARGE_INTEGER waitStart = {};
+	ULONG64 waitStartCycles = 0;
+	if (collectStats)
+	{
+		QueryPerformanceCounter(&waitStart);
+		QueryThreadCycleTime(GetCurrentThread(), &waitStartCycles);
+	}
+
+	int64_t blockedQpc = 0;
+	int64_t spinQpc = 0;
+	if (g_activeBackend == PacingBackend::WaitableTimer && !WaitWaitableTimer(deadlineQpc, blockedQpc, spinQpc))
+	{
+		Log("Pacing", "SetWaitableTimer failed (%lu); switching to sleep/yield pacing.\n", GetLastError());
+		g_activeBackend = PacingBackend::SleepYield;
+	}
+
+	if (g_activeBackend == PacingBackend::SleepYield)
+		WaitSleepYield(deadlineQpc, pacingFrameTimeUs, blockedQpc, spinQpc);
+
+	if (collectStats)
+		RecordPacingStats(deadlineQpc, pacingFrameTimeUs, waitStart.QuadPart, waitStartCycles);
+
+	PacingWaitSplit split = {};
+	split.blockedUs = QpcToUs(blockedQpc);
+	split.spinUs = QpcToUs(spinQpc);
+	return split;
+}
+
+const char* GetPacingBackendName()
+{
+	return g_activeBackend == PacingBackend::WaitableTimer ? "waitable_timer" : "sleep_yield";
+}
+} // namespace ts2fix
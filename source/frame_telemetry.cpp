@@ -0,0 +1,310 @@
+#include "stdafx.h"
+#include "ts2fix/frame_telemetry.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/runtime.h"
+#include "ts2fix/thread_policy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+using ts2fix::FrameSample;
+using ts2fix::FrameTimerCallsite;
+using ts2fix::FrameTimerMode;
+
+// Power of two. Roughly 28 s of frames at 144 Hz, far more than the drain thread ever falls behind.
+constexpr uint32_t kRingSize = 4096;
+constexpr DWORD kDrainIntervalMs = 100;
+
+constexpr int64_t kWindowUs = 10000000;
+constexpr uint32_t kMaxWindowFrames = 16384;
+constexpr std::size_t kMaxWindowRows = 8192;
+
+// Longer gaps are loading screens or a switch to another callsite, not frames.
+constexpr int64_t kPauseUs = 1000000;
+
+constexpr int32_t kHistogramBucketUs = 100;
+constexpr uint32_t kHistogramBuckets = 2000;
+
+constexpr std::size_t kCallsiteCount = static_cast<std::size_t>(FrameTimerCallsite::Count);
+
+FrameSample g_ring[kRingSize];
+std::atomic<uint32_t> g_ringHead{ 0 }; // advanced by the game thread
+std::atomic<uint32_t> g_ringTail{ 0 }; // advanced by the drain thread
+std::atomic<uint32_t> g_droppedSamples{ 0 };
+
+bool g_telemetryEnabled = false;
+HANDLE g_drainThread = nullptr;
+
+struct FrameTotals
+{
+	uint32_t frames = 0;
+	int64_t sumUs = 0;
+	int32_t maxUs = 0;
+	uint32_t stutters = 0;
+	int64_t blockedUs = 0;
+	int64_t spinUs = 0;
+	uint64_t steps = 0;
+};
+
+struct FramePercentiles
+{
+	int32_t p50Us = 0;
+	int32_t p95Us = 0;
+	int32_t p99Us = 0;
+	int32_t p999Us = 0;
+};
+
+struct WindowRow
+{
+	FrameTimerCallsite callsite;
+	FrameTimerMode mode;
+	double startSeconds;
+	int32_t targetUs;
+	FrameTotals totals;
+	FramePercentiles percentiles;
+};
+
+struct CallsiteAggregate
+{
+	int64_t lastEndQpc = 0;
+	FrameTimerMode mode = FrameTimerMode::LegacyPassthrough;
+	int32_t targetUs = 0;
+
+	int64_t windowStartQpc = 0;
+	uint32_t windowIntervalsUs[kMaxWindowFrames] = {};
+	FrameTotals window;
+
+	uint32_t histogram[kHistogramBuckets] = {};
+	FrameTotals session;
+};
+
+CallsiteAggregate g_aggregates[kCallsiteCount];
+std::vector<WindowRow> g_windowRows;
+int64_t g_sessionStartQpc = 0;
+
+int64_t QpcToUs(int64_t qpc)
+{
+	const int64_t frequency = ts2fix::GetRuntimeContext().performanceFrequency.QuadPart;
+	return frequency > 0 ? (qpc * 1000000) / frequency : 0;
+}
+
+void AddToTotals(FrameTotals& totals, int32_t intervalUs, const FrameSample& sample)
+{
+	totals.frames += 1;
+	totals.sumUs += intervalUs;
+	totals.maxUs = std::max(totals.maxUs, intervalUs);
+	if (intervalUs > sample.targetUs * 2)
+		totals.stutters += 1;
+	totals.blockedUs += sample.blockedUs;
+	totals.spinUs += sample.spinUs;
+	totals.steps += sample.steps;
+}
+
+int32_t SelectPercentile(uint32_t* intervals, uint32_t count, uint32_t permille)
+{
+	uint32_t* nth = intervals + (static_cast<uint64_t>(count - 1) * permille) / 1000;
+	std::nth_element(intervals, nth, intervals + count);
+	return static_cast<int32_t>(*nth);
+}
+
+// Bucket upper edge of the first bucket holding the permille-th sample; the overflow bucket reports the maximum.
+int32_t HistogramPercentile(const CallsiteAggregate& aggregate, uint32_t permille)
+{
+	const uint64_t rank = (static_cast<uint64_t>(aggregate.session.frames) * permille + 999) / 1000;
+	uint64_t seen = 0;
+	for (uint32_t bucket = 0; bucket + 1 < kHistogramBuckets; ++bucket)
+	{
+		seen += aggregate.histogram[bucket];
+		if (seen >= rank)
+			return std::min(static_cast<int32_t>((bucket + 1) * kHistogramBucketUs), aggregate.session.maxUs);
+	}
+	return aggregate.session.maxUs;
+}
+
+void CloseWindow(FrameTimerCallsite callsite, CallsiteAggregate& aggregate)
+{
+	const uint32_t frames = aggregate.window.frames;
+	if (frames != 0 && g_windowRows.size() < kMaxWindowRows)
+	{
+		WindowRow row = {};
+		row.callsite = callsite;
+		row.mode = aggregate.mode;
+		row.startSeconds = QpcToUs(aggregate.windowStartQpc - g_sessionStartQpc) / 1000000.0;
+		row.targetUs = aggregate.targetUs;
+		row.totals = aggregate.window;
+		row.percentiles.p50Us = SelectPercentile(aggregate.windowIntervalsUs, frames, 500);
+		row.percentiles.p95Us = SelectPercentile(aggregate.windowIntervalsUs, frames, 950);
+		row.percentiles.p99Us = SelectPercentile(aggregate.windowIntervalsUs, frames, 990);
+		row.percentiles.p999Us = SelectPercentile(aggregate.windowIntervalsUs, frames, 999);
+		g_windowRows.push_back(row);
+
+		TS2FIX_LOG_DIAGNOSTIC(Telemetry, "%s %u frames: p50=%dus p95=%dus p99=%dus p99.9=%dus max=%dus stutters=%u\n",
+			ts2fix::GetFrameTimerCallsiteName(callsite), frames, row.percentiles.p50Us, row.percentiles.p95Us,
+			row.percentiles.p99Us, row.percentiles.p999Us, row.totals.maxUs, row.totals.stutters);
+	}
+
+	aggregate.window = {};
+	aggregate.windowStartQpc = 0;
+}
+
+void AddSample(const FrameSample& sample)
+{
+	const auto callsite = sample.callsite;
+	if (callsite == FrameTimerCallsite::Unknown || callsite >= FrameTimerCallsite::Count)
+		return;
+
+	auto& aggregate = g_aggregates[static_cast<std::size_t>(callsite)];
+	const int64_t lastEndQpc = aggregate.lastEndQpc;
+	aggregate.lastEndQpc = sample.frameEndQpc;
+	aggregate.mode = sample.mode;
+	aggregate.targetUs = sample.targetUs;
+	if (g_sessionStartQpc == 0)
+		g_sessionStartQpc = sample.frameEndQpc;
+	if (lastEndQpc == 0)
+		return;
+
+	const int64_t intervalUs = QpcToUs(sample.frameEndQpc - lastEndQpc);
+	if (intervalUs < 0 || intervalUs > kPauseUs)
+		return;
+
+	if (aggregate.windowStartQpc != 0 &&
+		(QpcToUs(sample.frameEndQpc - aggregate.windowStartQpc) >= kWindowUs || aggregate.window.frames == kMaxWindowFrames))
+	{
+		CloseWindow(callsite, aggregate);
+	}
+	if (aggregate.windowStartQpc == 0)
+		aggregate.windowStartQpc = lastEndQpc;
+
+	const int32_t interval = static_cast<int32_t>(intervalUs);
+	aggregate.windowIntervalsUs[aggregate.window.frames] = static_cast<uint32_t>(interval);
+	AddToTotals(aggregate.window, interval, sample);
+	AddToTotals(aggregate.session, interval, sample);
+	aggregate.histogram[std::min<uint32_t>(static_cast<uint32_t>(interval / kHistogramBucketUs), kHistogramBuckets - 1)] += 1;
+}
+
+void DrainRing()
+{
+	const uint32_t head = g_ringHead.load(std::memory_order_acquire);
+	uint32_t tail = g_ringTail.load(std::memory_order_relaxed);
+	for (; tail != head; ++tail)
+	{
+		AddSample(g_ring[tail & (kRingSize - 1)]);
+		g_ringTail.store(tail + 1, std::memory_order_release);
+	}
+}
+
+DWORD WINAPI DrainThreadProc(LPVOID)
+{
+	for (;;)
+	{
+		Sleep(kDrainIntervalMs);
+		DrainRing();
+	}
+}
+
+void WriteRow(std::FILE* file, FrameTimerCallsite callsite, FrameTimerMode mode, const char* start, int32_t targetUs,
+	const FrameTotals& totals, const FramePercentiles& percentiles)
+{
+	const double frames = static_cast<double>(std::max<uint32_t>(totals.frames, 1));
+	std::fprintf(file, "%s,%s,%s,%u,%d,%.1f,%d,%d,%d,%d,%d,%u,%.1f,%.1f,%.3f\n",
+		ts2fix::GetFrameTimerCallsiteName(callsite), ts2fix::GetFrameTimerModeName(mode), start, totals.frames, targetUs,
+		totals.sumUs / frames, percentiles.p50Us, percentiles.p95Us, percentiles.p99Us, percentiles.p999Us, totals.maxUs,
+		totals.stutters, totals.blockedUs / frames, totals.spinUs / frames, totals.steps / frames);
+}
+} // namespace
+
+namespace ts2fix
+{
+void ConfigureFrameTelemetry(const FramerateConfig& config)
+{
+	if (!config.frameTelemetry || g_drainThread != nullptr)
+		return;
+
+	// Reserved up front so the drain thread never reallocates while the process might be torn down under it.
+	g_windowRows.reserve(kMaxWindowRows);
+	g_telemetryEnabled = true;
+
+	g_drainThread = CreateThread(nullptr, 0, DrainThreadProc, nullptr, 0, nullptr);
+	if (g_drainThread == nullptr)
+	{
+		g_telemetryEnabled = false;
+		Log("Telemetry", "Could not start the frame telemetry thread (%lu).\n", GetLastError());
+		return;
+	}
+
+	SetThreadPriority(g_drainThread, THREAD_PRIORITY_BELOW_NORMAL);
+	ts2fix::ApplyHelperThreadPolicy(g_drainThread);
+	Log("Telemetry", "Frame telemetry enabled.\n");
+}
+
+void RecordFrameSample(const FrameSample& sample)
+{
+	if (!g_telemetryEnabled)
+		return;
+
+	const uint32_t head = g_ringHead.load(std::memory_order_relaxed);
+	if (head - g_ringTail.load(std::memory_order_acquire) >= kRingSize)
+	{
+		g_droppedSamples.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	g_ring[head & (kRingSize - 1)] = sample;
+	g_ringHead.store(head + 1, std::memory_order_release);
+}
+
+void FlushFrameTelemetry()
+{
+	if (!g_telemetryEnabled)
+		return;
+	g_telemetryEnabled = false;
+
+	DrainRing();
+	for (std::size_t i = 0; i < kCallsiteCount; ++i)
+		CloseWindow(static_cast<FrameTimerCallsite>(i), g_aggregates[i]);
+
+	const std::string directory = GetLogDirectory();
+	if (directory.empty())
+		return;
+
+	const std::string path = directory + "ToyStory2Fix.frametimes.csv";
+	std::FILE* file = std::fopen(path.c_str(), "w");
+	if (file == nullptr)
+		return;
+
+	std::fputs("callsite,mode,window_start_s,frames,target_us,mean_us,p50_us,p95_us,p99_us,p999_us,max_us,stutters,"
+		"blocked_us_per_frame,spin_us_per_frame,steps_per_frame\n", file);
+
+	char start[32] = {};
+	for (const WindowRow& row : g_windowRows)
+	{
+		std::snprintf(start, sizeof(start), "%.1f", row.startSeconds);
+		WriteRow(file, row.callsite, row.mode, start, row.targetUs, row.totals, row.percentiles);
+	}
+
+	// Whole-session rows come from the 100 us histogram, so their percentiles are rounded up to the bucket edge.
+	for (std::size_t i = 0; i < kCallsiteCount; ++i)
+	{
+		const CallsiteAggregate& aggregate = g_aggregates[i];
+		if (aggregate.session.frames == 0)
+			continue;
+
+		FramePercentiles percentiles = {};
+		percentiles.p50Us = HistogramPercentile(aggregate, 500);
+		percentiles.p95Us = HistogramPercentile(aggregate, 950);
+		percentiles.p99Us = HistogramPercentile(aggregate, 990);
+		percentiles.p999Us = HistogramPercentile(aggregate, 999);
+		WriteRow(file, static_cast<FrameTimerCallsite>(i), aggregate.mode, "total", aggregate.targetUs, aggregate.session, percentiles);
+	}
+
+	const uint32_t dropped = g_droppedSamples.load(std::memory_order_relaxed);
+	if (dropped != 0)
+		std::fprintf(file, "# %u frame(s) dropped because the telemetry ring was full\n", dropped);
+	std::fclose(file);
+}
+} // namespace ts2fix
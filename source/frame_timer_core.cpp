@@ -0,0 +1,261 @@
+// Portable: no Windows headers or runtime context. tools/frame_timer_replay builds this file on the host.
+#include "ts2fix/frame_timer_core.h"
+
+#include <algorithm>
+
+namespace
+{
+using ts2fix::FrameTimerCallsite;
+using ts2fix::FrameTimerMode;
+using ts2fix::FrameTimerState;
+using ts2fix::kGameplayFrameTimeUs;
+
+int64_t CounterToUs(int64_t counter, int64_t frequency)
+{
+	if (frequency == 0)
+		return 0;
+	return (counter * 1000000) / frequency;
+}
+
+void HandleAnomalyFallback(
+	ts2fix::FrameTimerEnvironment& environment,
+	const ts2fix::FrameTimerTuning& tuning,
+	FrameTimerCallsite callsite,
+	FrameTimerState& state,
+	bool isDemoMode,
+	int speedMultiplier,
+	int frameTimeUs)
+{
+	if (isDemoMode || state.mode != FrameTimerMode::CustomZeroStep)
+	{
+		state.consecutiveZeroFrames = 0;
+		state.framesSinceNonZero = 0;
+		return;
+	}
+
+	if (speedMultiplier == 0)
+	{
+		state.consecutiveZeroFrames += 1;
+		state.framesSinceNonZero += 1;
+	}
+	else
+	{
+		state.consecutiveZeroFrames = 0;
+		state.framesSinceNonZero = 0;
+	}
+
+	if (!tuning.autoFallbackTo60)
+		return;
+
+	uint32_t zeroFrameThreshold = 120;
+	uint64_t zeroStepTimeThresholdUs = 2000000ULL;
+
+	if (callsite != FrameTimerCallsite::Gameplay && environment.IsStartupGuardActive())
+	{
+		zeroFrameThreshold = 24;
+		zeroStepTimeThresholdUs = 400000ULL;
+	}
+
+	const uint64_t noStepElapsedUs =
+		static_cast<uint64_t>(state.framesSinceNonZero) * static_cast<uint64_t>(std::max(frameTimeUs, 1));
+	const bool tooManyZeroFrames = state.consecutiveZeroFrames >= zeroFrameThreshold;
+	const bool noStepTooLong = noStepElapsedUs >= zeroStepTimeThresholdUs;
+
+	if (!tooManyZeroFrames && !noStepTooLong)
+		return;
+
+	if (callsite == FrameTimerCallsite::Gameplay)
+		ts2fix::SetFrameTimerMode(environment, callsite, state, FrameTimerMode::CustomSafe60, "anomaly detected");
+	else
+		ts2fix::SetFrameTimerMode(environment, callsite, state, FrameTimerMode::LegacyPassthrough, "anomaly detected");
+}
+} // namespace
+
+namespace ts2fix
+{
+const char* GetFrameTimerCallsiteName(FrameTimerCallsite callsite)
+{
+	switch (callsite)
+	{
+	case FrameTimerCallsite::Gameplay:
+		return "Gameplay";
+	case FrameTimerCallsite::Frontend:
+		return "Frontend";
+	case FrameTimerCallsite::Menu:
+		return "Menu";
+	default:
+		return "Unknown";
+	}
+}
+
+const char* GetFrameTimerModeName(FrameTimerMode mode)
+{
+	switch (mode)
+	{
+	case FrameTimerMode::LegacyPassthrough:
+		return "LegacyPassthrough";
+	case FrameTimerMode::CustomSafe60:
+		return "CustomSafe60";
+	case FrameTimerMode::CustomZeroStep:
+		return "CustomZeroStep";
+	default:
+		return "Unknown";
+	}
+}
+
+void ResetFrameTimerState(FrameTimerState& state)
+{
+	state.previousQpc = 0;
+	state.previousStartQpc = 0;
+	state.nextFrameDeadlineQpc = 0;
+	state.simulationAccumulatorUs = 0;
+	state.consecutiveZeroFrames = 0;
+	state.framesSinceNonZero = 0;
+}
+
+void SetFrameTimerMode(FrameTimerEnvironment& environment, FrameTimerCallsite callsite, FrameTimerState& state,
+	FrameTimerMode newMode, const char* reason)
+{
+	if (state.mode == newMode)
+		return;
+
+	const FrameTimerMode oldMode = state.mode;
+	state.mode = newMode;
+	state.modeSwitchCount += 1;
+	ResetFrameTimerState(state);
+	environment.OnModeChanged(callsite, oldMode, state, reason);
+}
+
+FrameTimerMode GetPreferredGameplayMode(const FrameTimerTuning& tuning)
+{
+	if (tuning.zeroSpeedSafetyReady && tuning.targetFrameTimeUs < kGameplayFrameTimeUs)
+		return FrameTimerMode::CustomZeroStep;
+	return FrameTimerMode::CustomSafe60;
+}
+
+// The accumulator turns each longer background frame into up to three simulation steps, so the game keeps running at
+// the right speed; focus coming back restores the full rate on the next frame.
+void ApplyBackgroundCap(FrameTimerEnvironment& environment, FrameTimerTuning& tuning, bool& inBackground)
+{
+	const bool background = tuning.backgroundFrameTimeUs != 0 && environment.IsGameInBackground();
+	if (background != inBackground)
+	{
+		inBackground = background;
+		environment.OnBackgroundChanged(background, tuning.backgroundFrameTimeUs);
+	}
+
+	if (background)
+		tuning.targetFrameTimeUs = std::max(tuning.targetFrameTimeUs, tuning.backgroundFrameTimeUs);
+}
+
+FrameTimerFrame RunFrameTimerFrame(FrameTimerEnvironment& environment, const FrameTimerTuning& tuning,
+	FrameTimerCallsite callsite, FrameTimerState& state, bool allowZeroStepSimulation)
+{
+	const int frameTimeUs = std::max(tuning.targetFrameTimeUs, 1);
+	const bool isDemoMode = *environment.GetIsDemoMode();
+	const int64_t frequency = environment.GetCounterFrequency();
+
+	int effectiveFrameTimeUs = frameTimeUs;
+	if (isDemoMode)
+	{
+		// Keep demo mode pacing tied to the original 60->30 behavior.
+		effectiveFrameTimeUs = 16667;
+	}
+	else if (!allowZeroStepSimulation && frameTimeUs < kGameplayFrameTimeUs)
+	{
+		// If zero-step simulation is unavailable, keep simulation at safe 60 Hz pacing.
+		effectiveFrameTimeUs = kGameplayFrameTimeUs;
+	}
+
+	if (state.previousQpc == 0)
+		state.previousQpc = environment.QueryCounter();
+	if (state.nextFrameDeadlineQpc == 0)
+		state.nextFrameDeadlineQpc = state.previousQpc;
+
+	FrameTimerFrame frame;
+	frame.previousEndQpc = state.previousQpc;
+	frame.frameStartQpc = environment.QueryCounter();
+
+	int64_t elapsedUs = CounterToUs(frame.frameStartQpc - state.previousQpc, frequency);
+	if (elapsedUs < 0)
+		elapsedUs = 0;
+	frame.elapsedUs = elapsedUs;
+
+	// The simulation has to cover the whole frame, pacing wait included. Measured from the previous frame's end it
+	// would only see the game's own work and run slow whenever that takes less than a frame.
+	const int64_t intervalStartQpc = state.previousStartQpc != 0 ? state.previousStartQpc : state.previousQpc;
+	const int64_t intervalUs = std::max<int64_t>(0, CounterToUs(frame.frameStartQpc - intervalStartQpc, frequency));
+	frame.intervalUs = intervalUs;
+	state.previousStartQpc = frame.frameStartQpc;
+
+	environment.BeginFrame(frame.frameStartQpc);
+
+	int framerateFactor = 0;
+	if (isDemoMode)
+	{
+		state.simulationAccumulatorUs = 0;
+		framerateFactor = (static_cast<int>(elapsedUs) / kGameplayFrameTimeUs) + 1;
+		if (framerateFactor < 2)
+			framerateFactor = 2;
+		framerateFactor = std::clamp(framerateFactor, 1, 3);
+		*environment.GetSpeedMultiplier() = static_cast<uint32_t>(framerateFactor);
+		state.consecutiveZeroFrames = 0;
+		state.framesSinceNonZero = 0;
+	}
+	else
+	{
+		int64_t simulationDeltaUs = intervalUs;
+		if (allowZeroStepSimulation && frameTimeUs < kGameplayFrameTimeUs)
+		{
+			const int64_t jitterAbsUs = (intervalUs >= frameTimeUs) ? (intervalUs - frameTimeUs) : (frameTimeUs - intervalUs);
+			const int64_t jitterToleranceUs = std::max<int64_t>(800, frameTimeUs / 3);
+			if (jitterAbsUs <= jitterToleranceUs)
+				simulationDeltaUs = frameTimeUs;
+		}
+
+		state.simulationAccumulatorUs += simulationDeltaUs;
+		const int64_t maxAccumulatorUs = static_cast<int64_t>(kGameplayFrameTimeUs) * 16;
+		if (state.simulationAccumulatorUs > maxAccumulatorUs)
+			state.simulationAccumulatorUs = maxAccumulatorUs;
+
+		const int desiredSteps = std::clamp(static_cast<int>(state.simulationAccumulatorUs / kGameplayFrameTimeUs), 0, 3);
+		if (desiredSteps > 0)
+			state.simulationAccumulatorUs -= static_cast<int64_t>(desiredSteps) * kGameplayFrameTimeUs;
+
+		const int minSpeedMultiplier = allowZeroStepSimulation ? 0 : 1;
+		framerateFactor = std::clamp(desiredSteps, minSpeedMultiplier, 3);
+
+		if (framerateFactor > desiredSteps)
+		{
+			state.simulationAccumulatorUs -= static_cast<int64_t>(framerateFactor - desiredSteps) * kGameplayFrameTimeUs;
+			if (state.simulationAccumulatorUs < 0)
+				state.simulationAccumulatorUs = 0;
+		}
+
+		*environment.GetSpeedMultiplier() = static_cast<uint32_t>(framerateFactor);
+		HandleAnomalyFallback(environment, tuning, callsite, state, false, framerateFactor, frameTimeUs);
+	}
+	frame.speedMultiplier = framerateFactor;
+
+	const int pacingFactor = isDemoMode ? std::max(framerateFactor, 2) : 1;
+	frame.pacingFrameTimeUs = effectiveFrameTimeUs * pacingFactor;
+	const int64_t frameDurationQpc =
+		std::max<int64_t>(1, (static_cast<int64_t>(frame.pacingFrameTimeUs) * frequency + 500000) / 1000000);
+
+	int64_t targetDeadlineQpc = state.nextFrameDeadlineQpc + frameDurationQpc;
+	const int64_t maxLagQpc = frameDurationQpc * 4;
+	if (frame.frameStartQpc > targetDeadlineQpc + maxLagQpc)
+		targetDeadlineQpc = frame.frameStartQpc + frameDurationQpc;
+	targetDeadlineQpc = environment.AlignDeadline(targetDeadlineQpc, frameDurationQpc, elapsedUs);
+	frame.deadlineQpc = targetDeadlineQpc;
+
+	frame.wait = environment.WaitForDeadline(targetDeadlineQpc, frame.pacingFrameTimeUs);
+
+	frame.frameEndQpc = environment.QueryCounter();
+	state.previousQpc = frame.frameEndQpc;
+	state.nextFrameDeadlineQpc = targetDeadlineQpc;
+
+	frame.timeMs = environment.GetTimeMs(frame.frameEndQpc);
+	return frame;
+}
+} // namespace ts2fix
@@ -2,9 +2,11 @@
 #include "ts2fix/frame_timer_install.h"
 
 #include "ts2fix/frame_timer.h"
+#include "ts2fix/late_wait.h"
 #include "ts2fix/logging.h"
 #include "ts2fix/pattern_utils.h"
 #include "ts2fix/runtime.h"
+#include "ts2fix/signatures.h"
 #include "ts2fix/zero_speed_safety.h"
 
 #include <MMSystem.h>
@@ -35,27 +37,27 @@ bool InstallFrameTimerHooks(const Config& config)
 	SetFrameTimerCallsiteAddresses(0, 0, 0);
 
 	runtime.targetRefreshRateOverride = static_cast<uint32_t>(std::max(timerConfig.targetRefreshRate, 0));
-	runtime.refreshRateProbePending = false;
+	runtime.trackWindowRefreshRate = false;
 	if (timerConfig.nativeRefreshRate)
 	{
 		const uint32_t refreshRate = runtime.targetRefreshRateOverride > 0
 			? runtime.targetRefreshRateOverride
 			: GetDesktopRefreshRate();
 		ApplyRefreshRate(refreshRate);
-		runtime.refreshRateProbePending = (runtime.targetRefreshRateOverride == 0);
+		runtime.trackWindowRefreshRate = (runtime.targetRefreshRateOverride == 0);
 	}
 	else
 	{
 		ApplyRefreshRate(60);
 	}
 
-	auto pattern = hook::pattern("8B 0D ? ? ? ? 2B F1 3B");
+	auto pattern = hook::pattern(signatures::kSpeedMultiplier);
 	if (!pattern.count_hint(1).empty())
 		runtime.variables.speedMultiplier = *reinterpret_cast<uint32_t**>(pattern.get_first(2));
 	else
 		Log("Init", "speedMultiplier pointer pattern not found.\n");
 
-	pattern = hook::pattern("39 3D ? ? ? ? 75 27");
+	pattern = hook::pattern(signatures::kIsDemoMode);
 	if (!pattern.count_hint(1).empty())
 		runtime.variables.isDemoMode = *reinterpret_cast<bool**>(pattern.get_first(2));
 	else
@@ -74,7 +76,7 @@ bool InstallFrameTimerHooks(const Config& config)
 
 	ConfigureFrameTimer(timerConfig);
 
-	pattern = hook::pattern("C7 05 ? ? ? ? 00 00 00 00 E8 ? ? ? ? E8 ? ? ? ? 33");
+	pattern = hook::pattern(signatures::kMenuFrameTimerCall);
 	if (!pattern.count_hint(1).empty())
 	{
 		auto* callInstruction = pattern.get_first<uint8_t>(10);
@@ -107,7 +109,7 @@ bool InstallFrameTimerHooks(const Config& config)
 
 		if (runtime.gameplayFrameTimerReturnAddress == 0)
 		{
-			pattern = hook::pattern("83 C4 08 6A 01 E8 ? ? ? ?");
+			pattern = hook::pattern(signatures::kGameplayFrameTimerCall);
 			if (!pattern.count_hint(1).empty())
 			{
 				auto* callInstruction = pattern.get_first<uint8_t>(5);
@@ -118,7 +120,7 @@ bool InstallFrameTimerHooks(const Config& config)
 
 		if (runtime.frontendFrameTimerReturnAddress == 0)
 		{
-			pattern = hook::pattern("E8 ? ? ? ? 6A 00 E8 ? ? ? ? 6A 01 E8 ? ? ? ? 83 C4");
+			pattern = hook::pattern(signatures::kFrontendFrameTimerCall);
 			if (!pattern.count_hint(1).empty())
 			{
 				auto* callInstruction = pattern.get_first<uint8_t>(7);
@@ -138,6 +140,7 @@ bool InstallFrameTimerHooks(const Config& config)
 			reinterpret_cast<void*>(runtime.menuFrameTimerReturnAddress));
 
 		InitializeFrameTimerModes();
+		InstallLateWaitHook(timerConfig);
 	}
 	else
 	{
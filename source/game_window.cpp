@@ -0,0 +1,183 @@
+#include "stdafx.h"
+#include "ts2fix/game_window.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/runtime.h"
+
+#include <atomic>
+
+namespace
+{
+constexpr ULONGLONG kDiscoveryIntervalMs = 250;
+
+HWND g_gameWindow = nullptr;
+WNDPROC g_originalWndProc = nullptr;
+HMONITOR g_gameMonitor = nullptr;
+ULONGLONG g_nextDiscoveryTickMs = 0;
+
+// Written from the window procedure, taken by the frame-timer hook. Both normally run on the game thread, but the
+// window may belong to another one.
+uint32_t g_windowRefreshRate = 0;
+std::atomic<uint32_t> g_pendingRefreshRate{ 0 };
+
+std::atomic<bool> g_appActive{ true };
+std::atomic<bool> g_minimized{ false };
+
+BOOL CALLBACK FindProcessWindow(HWND hwnd, LPARAM lParam)
+{
+	DWORD processId = 0;
+	GetWindowThreadProcessId(hwnd, &processId);
+
+	if (processId == GetCurrentProcessId() && IsWindowVisible(hwnd) && GetWindow(hwnd, GW_OWNER) == nullptr)
+	{
+		*reinterpret_cast<HWND*>(lParam) = hwnd;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+uint32_t GetMonitorRefreshRate(HMONITOR monitor)
+{
+	MONITORINFOEXA monitorInfo = {};
+	monitorInfo.cbSize = sizeof(monitorInfo);
+	if (!GetMonitorInfoA(monitor, &monitorInfo))
+		return 0;
+
+	DEVMODEA displayMode = {};
+	displayMode.dmSize = sizeof(displayMode);
+	if (EnumDisplaySettingsA(monitorInfo.szDevice, ENUM_CURRENT_SETTINGS, &displayMode) &&
+		displayMode.dmDisplayFrequency > 1 &&
+		displayMode.dmDisplayFrequency != 0xFFFFFFFFu)
+	{
+		return displayMode.dmDisplayFrequency;
+	}
+
+	return 0;
+}
+
+// Re-reads the refresh rate when the window's monitor or that monitor's mode may have changed.
+void CheckWindowMonitor(bool modeChanged, const char* reason)
+{
+	HMONITOR monitor = MonitorFromWindow(g_gameWindow, MONITOR_DEFAULTTONEAREST);
+	if (!modeChanged && monitor == g_gameMonitor)
+		return;
+	g_gameMonitor = monitor;
+
+	if (!ts2fix::GetRuntimeContext().trackWindowRefreshRate)
+		return;
+
+	const uint32_t refreshRate = GetMonitorRefreshRate(monitor);
+	if (refreshRate == 0 || refreshRate == g_windowRefreshRate)
+		return;
+
+	g_windowRefreshRate = refreshRate;
+	g_pendingRefreshRate.store(refreshRate, std::memory_order_release);
+	ts2fix::Log("Window", "%s: display refresh is %u Hz.\n", reason, refreshRate);
+}
+
+void ReleaseGameWindow()
+{
+	if (g_originalWndProc != nullptr)
+		SetWindowLongPtrA(g_gameWindow, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(g_originalWndProc));
+
+	TS2FIX_LOG_DIAGNOSTIC(Window, "Game window %p destroyed.\n", g_gameWindow);
+	g_gameWindow = nullptr;
+	g_originalWndProc = nullptr;
+	g_gameMonitor = nullptr;
+	g_nextDiscoveryTickMs = 0;
+}
+
+LRESULT CALLBACK GameWindowProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	const WNDPROC original = g_originalWndProc;
+	switch (message)
+	{
+	case WM_DISPLAYCHANGE:
+		CheckWindowMonitor(true, "Display mode changed");
+		break;
+	case WM_WINDOWPOSCHANGED:
+		CheckWindowMonitor(false, "Window moved to another monitor");
+		break;
+	case WM_ACTIVATEAPP:
+		g_appActive.store(wParam != FALSE, std::memory_order_relaxed);
+		break;
+	case WM_SIZE:
+		if (wParam == SIZE_MINIMIZED)
+			g_minimized.store(true, std::memory_order_relaxed);
+		else if (wParam == SIZE_RESTORED || wParam == SIZE_MAXIMIZED)
+			g_minimized.store(false, std::memory_order_relaxed);
+		break;
+	case WM_NCDESTROY:
+		ReleaseGameWindow();
+		break;
+	default:
+		break;
+	}
+	return CallWindowProcA(original, hwnd, message, wParam, lParam);
+}
+} // namespace
+
+namespace ts2fix
+{
+void UpdateGameWindow()
+{
+	if (g_gameWindow != nullptr)
+		return;
+
+	const ULONGLONG nowMs = GetTickCount64();
+	if (nowMs < g_nextDiscoveryTickMs)
+		return;
+	g_nextDiscoveryTickMs = nowMs + kDiscoveryIntervalMs;
+
+	// The frame timer runs on the thread that owns the game window, so the active window is usually it.
+	HWND window = GetActiveWindow();
+	if (window != nullptr)
+		window = GetAncestor(window, GA_ROOT);
+	if (window == nullptr || !IsWindowVisible(window))
+	{
+		window = nullptr;
+		EnumWindows(FindProcessWindow, reinterpret_cast<LPARAM>(&window));
+	}
+	if (window == nullptr)
+		return;
+
+	g_gameWindow = window;
+	g_originalWndProc = reinterpret_cast<WNDPROC>(
+		SetWindowLongPtrA(window, GWLP_WNDPROC, reinterpret_cast<LONG_PTR>(GameWindowProc)));
+	if (g_originalWndProc == nullptr)
+	{
+		Log("Window", "Failed to subclass game window %p (%lu); refresh and focus changes won't be followed.\n", window, GetLastError());
+	}
+	else
+	{
+		Log("Window", "Tracking game window %p.\n", window);
+
+		DWORD foregroundProcessId = 0;
+		GetWindowThreadProcessId(GetForegroundWindow(), &foregroundProcessId);
+		g_appActive.store(foregroundProcessId == GetCurrentProcessId(), std::memory_order_relaxed);
+		g_minimized.store(IsIconic(window) != FALSE, std::memory_order_relaxed);
+	}
+
+	CheckWindowMonitor(true, "Game window found");
+}
+
+HWND GetGameWindow()
+{
+	return g_gameWindow;
+}
+
+bool IsGameWindowInBackground()
+{
+	// Without the subclass nothing would ever report the window coming back, so it never counts as backgrounded.
+	if (g_originalWndProc == nullptr)
+		return false;
+	return !g_appActive.load(std::memory_order_relaxed) || g_minimized.load(std::memory_order_relaxed);
+}
+
+uint32_t TakeWindowRefreshRateChange()
+{
+	if (g_pendingRefreshRate.load(std::memory_order_relaxed) == 0)
+		return 0;
+	return g_pendingRefreshRate.exchange(0, std::memory_order_acquire);
+}
+} // namespace ts2fix
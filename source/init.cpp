@@ -2,9 +2,15 @@
 #include "ts2fix/init.h"
 
 #include "ts2fix/config.h"
+#include "ts2fix/config_snapshot.h"
 #include "ts2fix/frame_timer_install.h"
+#include "ts2fix/init_readiness.h"
+#include "ts2fix/live_metrics.h"
 #include "ts2fix/logging.h"
 #include "ts2fix/patches_misc.h"
+#include "ts2fix/pattern_utils.h"
+#include "ts2fix/signatures.h"
+#include "ts2fix/thread_policy.h"
 #include "ts2fix/widescreen.h"
 #include "ts2fix/zbuffer_fix.h"
 
@@ -12,6 +18,8 @@ namespace
 {
 constexpr ULONGLONG kInitTimeoutMs = 10000;
 constexpr DWORD kInitRetrySleepMs = 10;
+// Rescan interval while the readiness watcher is armed; it only matters if the watcher never fires.
+constexpr DWORD kInitWatchedRetryMs = 250;
 
 std::string GetExeDirectory()
 {
@@ -94,30 +102,61 @@ namespace ts2fix
 {
 DWORD WINAPI Init(LPVOID delayed)
 {
-	auto pattern = hook::pattern("03 D1 2B D7 85 D2 7E 09 52 E8 ? ? ? ?");
-	if (pattern.count_hint(1).empty() && delayed == nullptr)
+	auto pattern = hook::pattern(signatures::kInitReady);
+	if (delayed == nullptr && pattern.count_hint(1).empty())
 	{
+		// Packed executables are still being unpacked; have the game's first instruction wake the delayed thread.
+		if (GetSharedConfig().advanced.readinessWatch)
+			ArmReadinessWatcher();
 		CreateThread(0, 0, reinterpret_cast<LPTHREAD_START_ROUTINE>(&Init), reinterpret_cast<LPVOID>(1), 0, nullptr);
 		return 0;
 	}
 
 	if (delayed != nullptr)
 	{
+		SetReadinessScanThread();
 		const ULONGLONG startMs = GetTickCount64();
 		while (pattern.clear().count_hint(1).empty())
 		{
 			if (GetTickCount64() - startMs >= kInitTimeoutMs)
 			{
 				Log("Init", "Timeout waiting for target pattern.\n");
+				ReleaseReadinessWatcher();
 				return 0;
 			}
+
+			if (IsReadinessWatcherArmed())
+			{
+				WaitForReadinessSignal(kInitWatchedRetryMs);
+				continue;
+			}
+
+			// Not watched, or the watcher fired on code that isn't the game's yet: let it run and poll as before.
+			ReleaseReadinessWatcher();
 			Sleep(kInitRetrySleepMs);
 		}
+
+		// Found by a scan before the game's code ran from a guarded page; nothing is held, so drop the guards before
+		// the scan workers start reading those pages.
+		if (IsReadinessWatcherArmed())
+			ReleaseReadinessWatcher();
 	}
 
-	CIniReader iniReader("ToyStory2Fix.ini");
-	Config config = LoadConfig(iniReader);
+	const Config& config = GetSharedConfig();
+	SetDiagnosticSubsystems(config.framerate.diagnosticSubsystems);
 	SetDiagnosticsEnabled(config.framerate.diagnostics);
+	SetDiagnosticTraceEnabled(config.framerate.diagnosticTrace);
+	if (delayed != nullptr)
+	{
+		ConfigureThreadPolicy(config.framerate);
+		ApplyHelperThreadPolicy(GetCurrentThread());
+	}
+	if (config.framerate.liveMetrics)
+		OpenLiveMetrics(kLiveMetricsPublisherAsi);
+
+	// Without the delayed thread we are still inside DllMain, where scan workers could never start.
+	hook::set_scan_threads(delayed != nullptr ? config.advanced.scanThreads : 1);
+	PrefetchSignatures(true);
 
 	bool attemptedDdrawLoad = false;
 	DWORD ddrawLoadError = 0;
@@ -166,6 +205,8 @@ DWORD WINAPI Init(LPVOID delayed)
 	if (config.rendering.widescreen)
 		InstallWidescreenHook();
 
+	// Every installer has run; a game thread held by the readiness watcher can go on.
+	ReleaseReadinessWatcher();
 	return 0;
 }
 } // namespace ts2fix
@@ -0,0 +1,230 @@
+#include "stdafx.h"
+#include "ts2fix/init_readiness.h"
+#include "ts2fix/logging.h"
+
+namespace
+{
+constexpr uintptr_t kPageSize = 0x1000;
+constexpr std::size_t kMaxGuardedRanges = 8;
+
+// Upper bound for holding the game thread, in case init never releases it.
+constexpr DWORD kReleaseTimeoutMs = 10000;
+
+constexpr LONG kWatcherIdle = 0;
+constexpr LONG kWatcherArmed = 1;
+constexpr LONG kWatcherFired = 2;
+constexpr LONG kWatcherReleased = 3;
+
+struct GuardedRange
+{
+	uintptr_t begin;
+	uintptr_t end;
+};
+
+GuardedRange g_ranges[kMaxGuardedRanges] = {};
+std::size_t g_rangeCount = 0;
+volatile LONG g_watcherState = kWatcherIdle;
+volatile LONG g_guardingHandlers = 0; // handlers that may still re-guard a page
+volatile DWORD g_scanThreadId = 0;
+PVOID volatile g_openPage = nullptr;
+PVOID g_handler = nullptr;
+HANDLE g_signalEvent = nullptr;
+HANDLE g_releaseEvent = nullptr;
+
+const GuardedRange* FindRange(uintptr_t address)
+{
+	for (std::size_t i = 0; i < g_rangeCount; ++i)
+	{
+		if (address >= g_ranges[i].begin && address < g_ranges[i].end)
+			return &g_ranges[i];
+	}
+	return nullptr;
+}
+
+// Adds PAGE_GUARD on top of whatever protection each page has now; the unpacker may have changed it since arming.
+void GuardRange(uintptr_t begin, uintptr_t end)
+{
+	for (uintptr_t cursor = begin; cursor < end;)
+	{
+		MEMORY_BASIC_INFORMATION info = {};
+		if (VirtualQuery(reinterpret_cast<LPCVOID>(cursor), &info, sizeof(info)) == 0)
+			return;
+
+		const uintptr_t regionEnd = std::min(reinterpret_cast<uintptr_t>(info.BaseAddress) + info.RegionSize, end);
+		if (info.State == MEM_COMMIT && (info.Protect & (PAGE_GUARD | PAGE_NOACCESS)) == 0)
+		{
+			DWORD oldProtect = 0;
+			VirtualProtect(reinterpret_cast<LPVOID>(cursor), regionEnd - cursor, info.Protect | PAGE_GUARD, &oldProtect);
+		}
+		cursor = regionEnd;
+	}
+}
+
+void UnguardRange(uintptr_t begin, uintptr_t end)
+{
+	for (uintptr_t cursor = begin; cursor < end;)
+	{
+		MEMORY_BASIC_INFORMATION info = {};
+		if (VirtualQuery(reinterpret_cast<LPCVOID>(cursor), &info, sizeof(info)) == 0)
+			return;
+
+		const uintptr_t regionEnd = std::min(reinterpret_cast<uintptr_t>(info.BaseAddress) + info.RegionSize, end);
+		if (info.State == MEM_COMMIT && (info.Protect & PAGE_GUARD) != 0)
+		{
+			DWORD oldProtect = 0;
+			VirtualProtect(reinterpret_cast<LPVOID>(cursor), regionEnd - cursor, info.Protect & ~PAGE_GUARD, &oldProtect);
+		}
+		cursor = regionEnd;
+	}
+}
+
+LONG CALLBACK ReadinessGuardHandler(EXCEPTION_POINTERS* exceptionInfo)
+{
+	const EXCEPTION_RECORD* record = exceptionInfo->ExceptionRecord;
+	if (record->ExceptionCode != STATUS_GUARD_PAGE_VIOLATION || record->NumberParameters < 2)
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	const uintptr_t address = static_cast<uintptr_t>(record->ExceptionInformation[1]);
+	if (FindRange(address) == nullptr)
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	// The system already lifted the guard from this page, so retrying the access just works. The init thread's own
+	// signature scans are neither unpacking nor the game starting; WaitForReadinessSignal re-guards what they opened.
+	// Late hits after the watcher fired come from pages re-guarded while it was disarming.
+	if (GetCurrentThreadId() == g_scanThreadId || g_watcherState != kWatcherArmed)
+		return EXCEPTION_CONTINUE_EXECUTION;
+
+	const bool instructionFetch = record->ExceptionInformation[0] == 8 || reinterpret_cast<uintptr_t>(record->ExceptionAddress) == address;
+	if (!instructionFetch)
+	{
+		// Still being unpacked (or read). Leave only the page being worked on open and re-guard the previous one,
+		// which costs one fault per page instead of one per access. ReleaseReadinessWatcher waits for this to finish.
+		InterlockedIncrement(&g_guardingHandlers);
+		if (g_watcherState == kWatcherArmed)
+		{
+			PVOID page = reinterpret_cast<PVOID>(address & ~(kPageSize - 1));
+			PVOID previous = InterlockedExchangePointer(&g_openPage, page);
+			if (previous != nullptr && previous != page)
+				GuardRange(reinterpret_cast<uintptr_t>(previous), reinterpret_cast<uintptr_t>(previous) + kPageSize);
+		}
+		InterlockedDecrement(&g_guardingHandlers);
+		return EXCEPTION_CONTINUE_EXECUTION;
+	}
+
+	if (InterlockedCompareExchange(&g_watcherState, kWatcherFired, kWatcherArmed) == kWatcherArmed)
+	{
+		for (std::size_t i = 0; i < g_rangeCount; ++i)
+			UnguardRange(g_ranges[i].begin, g_ranges[i].end);
+
+		// Hold the game on its first instruction so installers patch code that hasn't run yet.
+		SetEvent(g_signalEvent);
+		WaitForSingleObject(g_releaseEvent, kReleaseTimeoutMs);
+	}
+	return EXCEPTION_CONTINUE_EXECUTION;
+}
+} // namespace
+
+namespace ts2fix
+{
+bool ArmReadinessWatcher()
+{
+	if (g_watcherState != kWatcherIdle)
+		return false;
+
+	uint8_t* moduleBase = reinterpret_cast<uint8_t*>(GetModuleHandle(nullptr));
+	auto* dosHeader = reinterpret_cast<IMAGE_DOS_HEADER*>(moduleBase);
+	if (moduleBase == nullptr || dosHeader->e_magic != IMAGE_DOS_SIGNATURE)
+		return false;
+
+	auto* ntHeaders = reinterpret_cast<IMAGE_NT_HEADERS*>(moduleBase + dosHeader->e_lfanew);
+	if (ntHeaders->Signature != IMAGE_NT_SIGNATURE)
+		return false;
+
+	g_signalEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+	g_releaseEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	if (g_signalEvent == nullptr || g_releaseEvent == nullptr)
+		return false;
+
+	// Executable sections only; the unpacker stub's own section is marked executable too, but the stub is already
+	// running when we load, so its pages are left alone by skipping the section holding the entry point.
+	const uintptr_t entryPoint = reinterpret_cast<uintptr_t>(moduleBase) + ntHeaders->OptionalHeader.AddressOfEntryPoint;
+	IMAGE_SECTION_HEADER* section = IMAGE_FIRST_SECTION(ntHeaders);
+	for (uint16_t i = 0; i < ntHeaders->FileHeader.NumberOfSections && g_rangeCount < kMaxGuardedRanges; ++i, ++section)
+	{
+		if ((section->Characteristics & IMAGE_SCN_MEM_EXECUTE) == 0 || section->Misc.VirtualSize == 0)
+			continue;
+
+		const uintptr_t begin = reinterpret_cast<uintptr_t>(moduleBase) + section->VirtualAddress;
+		const uintptr_t end = begin + ((section->Misc.VirtualSize + kPageSize - 1) & ~(kPageSize - 1));
+		if (entryPoint >= begin && entryPoint < end)
+			continue;
+
+		g_ranges[g_rangeCount++] = { begin, end };
+	}
+
+	if (g_rangeCount == 0)
+	{
+		Log("Init", "Readiness watcher: no code section to guard; polling instead.\n");
+		return false;
+	}
+
+	g_handler = AddVectoredExceptionHandler(1, &ReadinessGuardHandler);
+	if (g_handler == nullptr)
+	{
+		g_rangeCount = 0;
+		return false;
+	}
+
+	g_watcherState = kWatcherArmed;
+	for (std::size_t i = 0; i < g_rangeCount; ++i)
+		GuardRange(g_ranges[i].begin, g_ranges[i].end);
+
+	Log("Init", "Readiness watcher armed on %zu code section(s).\n", g_rangeCount);
+	return true;
+}
+
+bool IsReadinessWatcherArmed()
+{
+	return g_watcherState == kWatcherArmed;
+}
+
+void SetReadinessScanThread()
+{
+	g_scanThreadId = GetCurrentThreadId();
+}
+
+bool WaitForReadinessSignal(DWORD timeoutMs)
+{
+	if (g_signalEvent == nullptr)
+	{
+		Sleep(timeoutMs);
+		return false;
+	}
+
+	// Put back the guards the caller's last scan lifted.
+	if (g_watcherState == kWatcherArmed)
+	{
+		for (std::size_t i = 0; i < g_rangeCount; ++i)
+			GuardRange(g_ranges[i].begin, g_ranges[i].end);
+	}
+	return WaitForSingleObject(g_signalEvent, timeoutMs) == WAIT_OBJECT_0;
+}
+
+void ReleaseReadinessWatcher()
+{
+	if (g_handler == nullptr)
+		return;
+
+	// Once no handler can re-guard a page, nothing guarded is left behind for the handler to catch after it's gone.
+	InterlockedExchange(&g_watcherState, kWatcherReleased);
+	while (g_guardingHandlers != 0)
+		YieldProcessor();
+	for (std::size_t i = 0; i < g_rangeCount; ++i)
+		UnguardRange(g_ranges[i].begin, g_ranges[i].end);
+
+	SetEvent(g_releaseEvent);
+	RemoveVectoredExceptionHandler(g_handler);
+	g_handler = nullptr;
+	g_scanThreadId = 0;
+}
+} // namespace ts2fix
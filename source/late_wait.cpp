@@ -0,0 +1,144 @@
+#include "stdafx.h"
+#include "ts2fix/late_wait.h"
+#include "ts2fix/frame_pacing.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/pattern_utils.h"
+#include "ts2fix/runtime.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+// Poll-to-frame-timer estimate: the mean follows an eighth of each gap, the mean deviation a quarter, and the wait
+// leaves room for twice the deviation, the way TCP sizes its retransmit timeout.
+constexpr int64_t kGapMeanSmoothing = 8;
+constexpr int64_t kGapDeviationSmoothing = 4;
+constexpr int64_t kGapDeviationWeight = 2;
+
+bool g_installed = false;
+int64_t g_residualUs = 500;
+uintptr_t g_inputPollTarget = 0;
+
+// Game thread only.
+int64_t g_armedDeadlineQpc = 0; // next frame-timer deadline; 0 once the wait for it has run
+int g_armedFrameTimeUs = 0;
+int64_t g_pollQpc = 0;          // when the last armed wait let the input poll through
+int64_t g_gapMeanUs = -1;       // -1 until the first gap is measured
+int64_t g_gapDeviationUs = 0;
+
+int64_t UsToQpc(int64_t us)
+{
+	return (us * ts2fix::GetRuntimeContext().performanceFrequency.QuadPart) / 1000000;
+}
+
+int64_t QpcToUs(int64_t qpc)
+{
+	return (qpc * 1000000) / ts2fix::GetRuntimeContext().performanceFrequency.QuadPart;
+}
+
+void __cdecl WaitBeforeInputPoll()
+{
+	if (g_armedDeadlineQpc == 0)
+		return;
+
+	// Only the first poll after a frame waits; later ones in the same frame go straight through.
+	const int64_t frameDeadlineQpc = g_armedDeadlineQpc;
+	g_armedDeadlineQpc = 0;
+
+	if (g_gapMeanUs >= 0)
+	{
+		const int64_t leadUs = std::min<int64_t>(
+			g_gapMeanUs + kGapDeviationWeight * g_gapDeviationUs + g_residualUs, g_armedFrameTimeUs);
+		ts2fix::WaitForFrameDeadline(frameDeadlineQpc - UsToQpc(leadUs), g_armedFrameTimeUs);
+	}
+
+	LARGE_INTEGER now = {};
+	QueryPerformanceCounter(&now);
+	g_pollQpc = now.QuadPart;
+}
+
+// Stands in for the input poll with the caller's arguments and registers untouched: waits, then jumps on to the poll,
+// which returns straight to the caller.
+__declspec(naked) void InputPollThunk()
+{
+	__asm
+	{
+		pushad
+		pushfd
+		call WaitBeforeInputPoll
+		popfd
+		popad
+		jmp dword ptr [g_inputPollTarget]
+	}
+}
+} // namespace
+
+namespace ts2fix
+{
+bool InstallLateWaitHook(const FramerateConfig& config)
+{
+	if (!config.lateWait || g_installed)
+		return g_installed;
+
+	if (config.inputPollCall.empty())
+	{
+		Log("LateWait", "late_wait needs [Framerate] input_poll_call; waiting at the frame-timer callsite instead.\n");
+		return false;
+	}
+
+	auto pattern = hook::pattern(config.inputPollCall);
+	if (pattern.size() != 1)
+	{
+		Log("LateWait", "input_poll_call matched %zu times, expected once; late wait disabled.\n", pattern.size());
+		return false;
+	}
+
+	auto* callInstruction = pattern.get_first<uint8_t>(config.inputPollCallOffset);
+	if (*callInstruction != 0xE8)
+	{
+		Log("LateWait", "input_poll_call_offset %d points at %02X, not a call; late wait disabled.\n",
+			config.inputPollCallOffset, *callInstruction);
+		return false;
+	}
+
+	g_inputPollTarget = ResolveRelativeCall(callInstruction);
+	g_residualUs = static_cast<int64_t>(config.lateWaitResidualUs);
+	injector::MakeCALL(callInstruction, InputPollThunk);
+	g_installed = true;
+
+	Log("LateWait", "Waiting before the input poll at %p (calls %p), residual %lld us.\n",
+		callInstruction, reinterpret_cast<void*>(g_inputPollTarget), static_cast<long long>(g_residualUs));
+	return true;
+}
+
+void OnLateWaitFrame(const FrameTimerFrame& frame)
+{
+	if (!g_installed)
+		return;
+
+	if (g_pollQpc != 0)
+	{
+		// Loads and hitches would blow the estimate up for seconds; a gap past two frames counts as two frames.
+		const int64_t gapUs = std::clamp<int64_t>(QpcToUs(frame.frameStartQpc - g_pollQpc), 0, frame.pacingFrameTimeUs * 2);
+		if (g_gapMeanUs < 0)
+		{
+			g_gapMeanUs = gapUs;
+			g_gapDeviationUs = gapUs / 2;
+		}
+		else
+		{
+			const int64_t errorUs = gapUs - g_gapMeanUs;
+			g_gapMeanUs += errorUs / kGapMeanSmoothing;
+			g_gapDeviationUs += (std::abs(errorUs) - g_gapDeviationUs) / kGapDeviationSmoothing;
+		}
+		g_pollQpc = 0;
+
+		TS2FIX_LOG_DIAGNOSTIC(LateWait, "poll->timer %lld us, estimate %lld +/- %lld us\n",
+			static_cast<long long>(gapUs), static_cast<long long>(g_gapMeanUs), static_cast<long long>(g_gapDeviationUs));
+	}
+
+	g_armedDeadlineQpc = frame.deadlineQpc + UsToQpc(frame.pacingFrameTimeUs);
+	g_armedFrameTimeUs = frame.pacingFrameTimeUs;
+}
+} // namespace ts2fix
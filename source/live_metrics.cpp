@@ -0,0 +1,130 @@
+#include "stdafx.h"
+#include "ts2fix/live_metrics.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/runtime.h"
+
+#include <cstring>
+
+namespace
+{
+static_assert(ts2fix::kLiveMetricsCallsites == static_cast<uint32_t>(ts2fix::FrameTimerCallsite::Count),
+	"live metrics layout needs a slot per frame-timer callsite");
+
+HANDLE g_mapping = nullptr;
+ts2fix::LiveMetricsBlock* g_block = nullptr;
+
+volatile LONG* GetSequence()
+{
+	return reinterpret_cast<volatile LONG*>(&g_block->sequence);
+}
+
+// Readers retry while the sequence is odd, so every update sits between these two.
+void BeginUpdate()
+{
+	InterlockedIncrement(GetSequence());
+}
+
+void EndUpdate()
+{
+	InterlockedIncrement(GetSequence());
+}
+
+ts2fix::LiveCallsiteMetrics& GetCallsiteMetrics(ts2fix::FrameTimerCallsite callsite)
+{
+	return g_block->callsites[static_cast<std::size_t>(callsite)];
+}
+} // namespace
+
+namespace ts2fix
+{
+bool OpenLiveMetrics(uint32_t publisherBit)
+{
+	if (g_block == nullptr)
+	{
+		char name[64] = {};
+		FormatLiveMetricsName(name, sizeof(name), GetCurrentProcessId());
+
+		g_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(LiveMetricsBlock), name);
+		if (g_mapping == nullptr)
+		{
+			Log("Metrics", "Could not create %s (%lu).\n", name, GetLastError());
+			return false;
+		}
+
+		const bool created = GetLastError() != ERROR_ALREADY_EXISTS;
+		g_block = static_cast<LiveMetricsBlock*>(MapViewOfFile(g_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LiveMetricsBlock)));
+		if (g_block == nullptr)
+		{
+			Log("Metrics", "Could not map %s (%lu).\n", name, GetLastError());
+			CloseHandle(g_mapping);
+			g_mapping = nullptr;
+			return false;
+		}
+
+		// Fresh mappings are zero-filled; only the header needs writing. The other module may already be publishing.
+		if (created)
+		{
+			g_block->version = kLiveMetricsVersion;
+			g_block->size = sizeof(LiveMetricsBlock);
+			g_block->processId = GetCurrentProcessId();
+			g_block->qpcFrequency = GetRuntimeContext().performanceFrequency.QuadPart;
+		}
+		TS2FIX_LOG_DIAGNOSTIC(Metrics, "%s live metrics block %s.\n", created ? "Created" : "Joined", name);
+	}
+
+	InterlockedOr(reinterpret_cast<volatile LONG*>(&g_block->publishers), static_cast<LONG>(publisherBit));
+	return true;
+}
+
+void PublishFrameTimerCall(FrameTimerCallsite callsite)
+{
+	if (g_block == nullptr)
+		return;
+
+	BeginUpdate();
+	GetCallsiteMetrics(callsite).hookCalls += 1;
+	EndUpdate();
+}
+
+void PublishFrameTimerMode(FrameTimerCallsite callsite, FrameTimerMode mode, uint32_t modeSwitches)
+{
+	if (g_block == nullptr)
+		return;
+
+	BeginUpdate();
+	auto& metrics = GetCallsiteMetrics(callsite);
+	metrics.mode = static_cast<uint32_t>(mode);
+	metrics.modeSwitches = modeSwitches;
+	EndUpdate();
+}
+
+void PublishFrameTime(FrameTimerCallsite callsite, int64_t frameEndQpc, uint32_t frameUs)
+{
+	if (g_block == nullptr)
+		return;
+
+	BeginUpdate();
+	auto& metrics = GetCallsiteMetrics(callsite);
+	metrics.pacedFrames += 1;
+	metrics.lastFrameUs = frameUs;
+
+	const std::size_t slot = static_cast<std::size_t>(g_block->frameCount % kLiveMetricsFrameHistory);
+	g_block->frameTimesUs[slot] = frameUs;
+	g_block->frameCallsites[slot] = static_cast<uint8_t>(callsite);
+	g_block->frameCount += 1;
+	g_block->lastUpdateQpc = frameEndQpc;
+	EndUpdate();
+}
+
+void PublishRefreshTarget(uint32_t refreshHz, int targetFrameTimeUs)
+{
+	if (g_block == nullptr)
+		return;
+
+	BeginUpdate();
+	g_block->targetRefreshHz = refreshHz;
+	g_block->targetFrameTimeUs = targetFrameTimeUs;
+	g_block->qpcFrequency = GetRuntimeContext().performanceFrequency.QuadPart;
+	EndUpdate();
+}
+} // namespace ts2fix
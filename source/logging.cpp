@@ -1,19 +1,45 @@
 #include "stdafx.h"
 #include "ts2fix/logging.h"
+#include "ts2fix/trace_format.h"
 
+#include <algorithm>
+#include <cctype>
+#include <atomic>
 #include <cstdarg>
+#include <cstdint>
 #include <cstring>
 #include <cstdio>
+#include <iterator>
 #include <mutex>
 #include <string>
 
 namespace
 {
 bool g_diagnosticsEnabled = false;
+uint32_t g_subsystemFilter = ~0u;
+
+const char* const kSubsystemNames[] = { "FrameTimer", "Pacing", "LateWait", "Vblank", "Window", "Timer", "Threads",
+	"Telemetry", "Metrics", "Safety", "ModernDepth", "Other" };
+static_assert(std::size(kSubsystemNames) == static_cast<std::size_t>(ts2fix::LogSubsystem::Count));
+
+ts2fix::LogSubsystem FindSubsystem(const char* name, std::size_t length)
+{
+	for (std::size_t i = 0; i < std::size(kSubsystemNames); ++i)
+	{
+		if (std::strlen(kSubsystemNames[i]) == length && _strnicmp(kSubsystemNames[i], name, length) == 0)
+			return static_cast<ts2fix::LogSubsystem>(i);
+	}
+	return ts2fix::LogSubsystem::Count;
+}
+
+void UpdateDiagnosticMask()
+{
+	ts2fix::detail::g_diagnosticMask.store(g_diagnosticsEnabled ? g_subsystemFilter : 0, std::memory_order_relaxed);
+}
 
 std::once_flag g_logInitOnce;
-std::mutex g_logMutex;
 std::FILE* g_logFile = nullptr;
+std::string g_logDirectory;
 
 std::string GetExeDirectory()
 {
@@ -52,12 +78,15 @@ std::string GetTempDirectory()
 	return tempPath;
 }
 
-std::FILE* TryOpenLogFile(const std::string& path)
+std::FILE* TryOpenLogFile(const std::string& directory)
 {
-	if (path.empty())
+	if (directory.empty())
 		return nullptr;
 
-	return std::fopen(path.c_str(), "a");
+	std::FILE* file = std::fopen((directory + "ToyStory2Fix.log").c_str(), "a");
+	if (file != nullptr)
+		g_logDirectory = directory;
+	return file;
 }
 
 void InitializeLogFile()
@@ -67,16 +96,16 @@ void InitializeLogFile()
 	{
 		const std::string scriptsDir = exeDir + "scripts";
 		if (EnsureDirectoryExists(scriptsDir))
-			g_logFile = TryOpenLogFile(scriptsDir + "\\ToyStory2Fix.log");
+			g_logFile = TryOpenLogFile(scriptsDir + "\\");
 
 		if (g_logFile == nullptr)
-			g_logFile = TryOpenLogFile(exeDir + "ToyStory2Fix.log");
+			g_logFile = TryOpenLogFile(exeDir);
 	}
 
 	if (g_logFile == nullptr)
 	{
 		const std::string tempDir = GetTempDirectory();
-		g_logFile = TryOpenLogFile(tempDir + "ToyStory2Fix.log");
+		g_logFile = TryOpenLogFile(tempDir);
 	}
 
 	if (g_logFile != nullptr)
@@ -86,18 +115,281 @@ void InitializeLogFile()
 	}
 }
 
-void WriteLogLineToFile(const char* line)
+// Lines go through a bounded multi-producer queue (Vyukov's sequence-numbered ring) to a writer thread, so a
+// thread that logs pays for one formatting pass into its slot and never waits on the file, the debugger or another
+// thread. A full queue drops the line and counts it rather than block. Trace records (see trace_format.h) share the
+// queue and go to their own file.
+constexpr uint32_t kLogSlotCount = 256;
+constexpr DWORD kWriterIntervalMs = 25;
+constexpr DWORD kFlushTimeoutMs = 250;
+constexpr uint32_t kTraceFormatCount = 512;
+
+enum class LogSlotKind : uint16_t
 {
-	std::call_once(g_logInitOnce, InitializeLogFile);
-	if (g_logFile == nullptr || line == nullptr)
+	Text,
+	Trace,
+};
+
+struct LogSlot
+{
+	std::atomic<uint32_t> sequence;
+	uint16_t length;
+	LogSlotKind kind;
+	char text[1016];
+};
+
+// A diagnostic format seen in trace mode, keyed by the address of its format string. The slot's index is the format
+// ID. state stays Pending until the claiming thread has filled the entry in; meanwhile the format is logged as text.
+enum class TraceFormatState : int
+{
+	Pending,
+	Ready,
+	Untraceable,
+};
+
+struct TraceFormat
+{
+	std::atomic<const char*> format;
+	std::atomic<TraceFormatState> state;
+	const char* subsystem;
+	int argCount;
+	ts2fix::TraceArgKind kinds[ts2fix::kTraceMaxArgs];
+};
+
+std::once_flag g_queueInitOnce;
+LogSlot g_slots[kLogSlotCount];
+std::atomic<uint32_t> g_enqueuePos{0};
+std::atomic<uint32_t> g_dequeuePos{0};
+std::atomic<uint32_t> g_droppedLines{0};
+std::atomic<bool> g_draining{false};
+HANDLE g_writerWake = nullptr;
+bool g_writerRunning = false;
+LPTOP_LEVEL_EXCEPTION_FILTER g_previousExceptionFilter = nullptr;
+
+bool g_traceEnabled = false;
+TraceFormat g_traceFormats[kTraceFormatCount];
+
+// Whoever holds g_draining owns the dequeue side and the files.
+char g_batch[64 * 1024];
+std::size_t g_batchLength = 0;
+std::once_flag g_traceInitOnce;
+std::FILE* g_traceFile = nullptr;
+
+// <module name>.trace next to the log, so the ASI and the ddraw.dll wrapper each keep their own.
+void InitializeTraceFile()
+{
+	const std::string directory = ts2fix::GetLogDirectory();
+	HMODULE module = nullptr;
+	char modulePath[MAX_PATH] = {};
+	if (directory.empty()
+		|| !GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+			reinterpret_cast<LPCSTR>(&g_traceFormats), &module)
+		|| GetModuleFileNameA(module, modulePath, MAX_PATH) == 0)
 		return;
 
-	std::lock_guard<std::mutex> lock(g_logMutex);
-	std::fputs(line, g_logFile);
-	const std::size_t len = std::strlen(line);
-	if (len == 0 || line[len - 1] != '\n')
-		std::fputc('\n', g_logFile);
-	std::fflush(g_logFile);
+	std::string name = modulePath;
+	name = name.substr(name.find_last_of("\\/") + 1);
+	name = name.substr(0, name.find_last_of('.'));
+
+	g_traceFile = std::fopen((directory + name + ".trace").c_str(), "wb");
+	if (g_traceFile == nullptr)
+		return;
+
+	LARGE_INTEGER frequency = {};
+	LARGE_INTEGER now = {};
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+
+	ts2fix::TraceFileHeader header = {};
+	std::memcpy(header.magic, ts2fix::kTraceMagic, sizeof(header.magic));
+	header.version = ts2fix::kTraceVersion;
+	header.pointerSize = sizeof(void*);
+	header.qpcFrequency = frequency.QuadPart;
+	header.startQpc = now.QuadPart;
+	std::fwrite(&header, sizeof(header), 1, g_traceFile);
+}
+
+void FlushBatch()
+{
+	if (g_batchLength != 0 && g_logFile != nullptr)
+		std::fwrite(g_batch, 1, g_batchLength, g_logFile);
+	g_batchLength = 0;
+}
+
+void AppendToBatch(const char* text, std::size_t length)
+{
+	OutputDebugStringA(text);
+	if (g_logFile == nullptr)
+		return;
+	if (g_batchLength + length > sizeof(g_batch))
+		FlushBatch();
+	std::memcpy(g_batch + g_batchLength, text, length);
+	g_batchLength += length;
+}
+
+// Writes out every published line, stopping at the first slot that is free or claimed but not yet published.
+// skipUnpublished is for process exit, where a claimed slot will never be published because its thread is gone; the
+// drain steps over it to the lines behind it. Returns false without writing if another thread is draining.
+bool DrainQueue(bool skipUnpublished)
+{
+	if (g_draining.exchange(true, std::memory_order_acquire))
+		return false;
+
+	std::call_once(g_logInitOnce, InitializeLogFile);
+
+	bool wrote = false;
+	bool traced = false;
+	uint32_t position = g_dequeuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		LogSlot& slot = g_slots[position % kLogSlotCount];
+		if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+		{
+			if (!skipUnpublished || position == g_enqueuePos.load(std::memory_order_relaxed))
+				break;
+
+			slot.sequence.store(position + kLogSlotCount, std::memory_order_release);
+			position += 1;
+			g_dequeuePos.store(position, std::memory_order_release);
+			continue;
+		}
+
+		if (slot.kind == LogSlotKind::Trace)
+		{
+			std::call_once(g_traceInitOnce, InitializeTraceFile);
+			if (g_traceFile != nullptr)
+				std::fwrite(slot.text, 1, slot.length, g_traceFile);
+			traced = true;
+		}
+		else
+		{
+			AppendToBatch(slot.text, slot.length);
+			wrote = true;
+		}
+		slot.sequence.store(position + kLogSlotCount, std::memory_order_release);
+		position += 1;
+		g_dequeuePos.store(position, std::memory_order_release);
+	}
+
+	const uint32_t dropped = g_droppedLines.exchange(0, std::memory_order_relaxed);
+	if (dropped != 0)
+	{
+		char line[96];
+		const int length = std::snprintf(line, sizeof(line), "ToyStory2Fix:Log: %u lines dropped (log queue full)\n", dropped);
+		AppendToBatch(line, static_cast<std::size_t>(length));
+		wrote = true;
+	}
+
+	if (wrote && g_logFile != nullptr)
+	{
+		FlushBatch();
+		std::fflush(g_logFile);
+	}
+	if (traced && g_traceFile != nullptr)
+		std::fflush(g_traceFile);
+
+	g_draining.store(false, std::memory_order_release);
+	return true;
+}
+
+// Waits up to timeoutMs until every line claimed before the call is written, or the drain has stopped at a slot that
+// is claimed but not published. The writer thread does the writing; without one the caller drains, but never takes the
+// queue from a thread that is draining, however slow.
+void WaitForDrain(DWORD timeoutMs)
+{
+	const uint32_t target = g_enqueuePos.load(std::memory_order_acquire);
+	const DWORD start = GetTickCount();
+	for (;;)
+	{
+		if (g_writerRunning)
+			SetEvent(g_writerWake);
+		else
+			DrainQueue(false);
+
+		const uint32_t position = g_dequeuePos.load(std::memory_order_acquire);
+		const bool caughtUp = static_cast<int32_t>(position - target) >= 0
+			|| g_slots[position % kLogSlotCount].sequence.load(std::memory_order_acquire) != position + 1;
+		if ((caughtUp && !g_draining.load(std::memory_order_acquire)) || GetTickCount() - start >= timeoutMs)
+			return;
+		Sleep(1);
+	}
+}
+
+DWORD WINAPI LogWriterThread(LPVOID)
+{
+	for (;;)
+	{
+		WaitForSingleObject(g_writerWake, kWriterIntervalMs);
+		DrainQueue(false);
+	}
+}
+
+LONG WINAPI FlushLogOnCrash(EXCEPTION_POINTERS* exception)
+{
+	if (exception != nullptr && exception->ExceptionRecord != nullptr)
+	{
+		ts2fix::Log("Log", "Unhandled exception %08lX at %p.\n",
+			exception->ExceptionRecord->ExceptionCode, exception->ExceptionRecord->ExceptionAddress);
+	}
+	ts2fix::FlushLog();
+
+	return g_previousExceptionFilter != nullptr ? g_previousExceptionFilter(exception) : EXCEPTION_CONTINUE_SEARCH;
+}
+
+void InitializeLogQueue()
+{
+	for (uint32_t i = 0; i < kLogSlotCount; i++)
+		g_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+	// Safe under the loader lock: the thread starts running once DllMain returns, and lines logged until then wait in
+	// the queue.
+	g_writerWake = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+	HANDLE writer = g_writerWake != nullptr ? CreateThread(nullptr, 0, LogWriterThread, nullptr, 0, nullptr) : nullptr;
+	if (writer != nullptr)
+	{
+		SetThreadPriority(writer, THREAD_PRIORITY_BELOW_NORMAL);
+		CloseHandle(writer);
+		g_writerRunning = true;
+	}
+
+	g_previousExceptionFilter = SetUnhandledExceptionFilter(FlushLogOnCrash);
+}
+
+// Claims the next free slot; nullptr (and the line counted as dropped) when the queue is full.
+LogSlot* ClaimSlot(uint32_t& position)
+{
+	std::call_once(g_queueInitOnce, InitializeLogQueue);
+
+	position = g_enqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		LogSlot* slot = &g_slots[position % kLogSlotCount];
+		const int32_t lag = static_cast<int32_t>(slot->sequence.load(std::memory_order_acquire) - position);
+		if (lag == 0)
+		{
+			if (g_enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				return slot;
+		}
+		else if (lag < 0)
+		{
+			g_droppedLines.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		else
+		{
+			position = g_enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+void PublishSlot(LogSlot* slot, uint32_t position)
+{
+	slot->sequence.store(position + 1, std::memory_order_release);
+
+	if (!g_writerRunning)
+		WaitForDrain(kFlushTimeoutMs);
+	else if (position + 1 - g_dequeuePos.load(std::memory_order_relaxed) >= kLogSlotCount / 2)
+		SetEvent(g_writerWake);
 }
 
 void LogImpl(bool diagnosticOnly, const char* subsystem, const char* format, va_list args)
@@ -105,23 +397,273 @@ void LogImpl(bool diagnosticOnly, const char* subsystem, const char* format, va_
 	if (diagnosticOnly && !g_diagnosticsEnabled)
 		return;
 
-	char messageBuffer[768] = {};
-	std::vsnprintf(messageBuffer, sizeof(messageBuffer), format, args);
+	uint32_t position = 0;
+	LogSlot* slot = ClaimSlot(position);
+	if (slot == nullptr)
+		return;
+
+	// One byte is kept back for the newline every line ends with.
+	const std::size_t capacity = sizeof(slot->text) - 1;
+	int length = std::snprintf(slot->text, capacity, "ToyStory2Fix:%s: ",
+		(subsystem != nullptr && subsystem[0] != '\0') ? subsystem : "Core");
+	length = std::clamp(length, 0, static_cast<int>(capacity) - 1);
+	const int messageLength = std::vsnprintf(slot->text + length, capacity - length, format, args);
+	length = std::clamp(length + std::max(messageLength, 0), 0, static_cast<int>(capacity) - 1);
+	if (length == 0 || slot->text[length - 1] != '\n')
+		slot->text[length++] = '\n';
+	slot->text[length] = '\0';
+	slot->length = static_cast<uint16_t>(length);
+	slot->kind = LogSlotKind::Text;
+	PublishSlot(slot, position);
+}
+
+// Appends raw bytes to a trace record being built in a slot.
+struct TraceWriter
+{
+	char* data;
+	std::size_t length;
+
+	template <typename T>
+	void Put(const T& value)
+	{
+		std::memcpy(data + length, &value, sizeof(value));
+		length += sizeof(value);
+	}
+
+	void PutBytes(const void* bytes, std::size_t count)
+	{
+		std::memcpy(data + length, bytes, count);
+		length += count;
+	}
+
+	void Finish(ts2fix::TraceRecordType type)
+	{
+		const ts2fix::TraceRecordHeader header = { type, static_cast<uint16_t>(length) };
+		std::memcpy(data, &header, sizeof(header));
+	}
+};
+
+// Queues the Format record that names a format ID; false if it doesn't fit in a slot.
+bool PublishTraceFormat(uint16_t id, const TraceFormat& entry, const char* format)
+{
+	const std::size_t subsystemLength = std::strlen(entry.subsystem) + 1;
+	const std::size_t formatLength = std::strlen(format) + 1;
+	if (sizeof(ts2fix::TraceRecordHeader) + 3 + entry.argCount + subsystemLength + formatLength > sizeof(LogSlot::text))
+		return false;
+
+	uint32_t position = 0;
+	LogSlot* slot = ClaimSlot(position);
+	if (slot == nullptr)
+		return false;
+
+	TraceWriter writer = { slot->text, sizeof(ts2fix::TraceRecordHeader) };
+	writer.Put(id);
+	writer.Put(static_cast<uint8_t>(entry.argCount));
+	writer.PutBytes(entry.kinds, static_cast<std::size_t>(entry.argCount));
+	writer.PutBytes(entry.subsystem, subsystemLength);
+	writer.PutBytes(format, formatLength);
+	writer.Finish(ts2fix::TraceRecordType::Format);
+
+	slot->length = static_cast<uint16_t>(writer.length);
+	slot->kind = LogSlotKind::Trace;
+	PublishSlot(slot, position);
+	return true;
+}
+
+// Format ID for a format/subsystem pair, registering it on first use; -1 while it can't be traced (yet).
+int FindTraceFormat(const char* subsystem, const char* format)
+{
+	const uint32_t hash = static_cast<uint32_t>((reinterpret_cast<uintptr_t>(format) >> 2) * 2654435761u);
+	for (uint32_t probe = 0; probe < kTraceFormatCount; ++probe)
+	{
+		const uint32_t index = (hash + probe) % kTraceFormatCount;
+		TraceFormat& entry = g_traceFormats[index];
+
+		const char* key = entry.format.load(std::memory_order_acquire);
+		if (key == nullptr)
+		{
+			if (!entry.format.compare_exchange_strong(key, format, std::memory_order_acq_rel))
+			{
+				if (key != format)
+					continue;
+			}
+			else
+			{
+				entry.subsystem = subsystem;
+				entry.argCount = ts2fix::ParseTraceArgKinds(format, entry.kinds, ts2fix::kTraceMaxArgs);
+				const bool traceable = entry.argCount >= 0 && PublishTraceFormat(static_cast<uint16_t>(index), entry, format);
+				entry.state.store(traceable ? TraceFormatState::Ready : TraceFormatState::Untraceable, std::memory_order_release);
+				return traceable ? static_cast<int>(index) : -1;
+			}
+		}
+		else if (key != format)
+		{
+			continue;
+		}
+
+		const TraceFormatState state = entry.state.load(std::memory_order_acquire);
+		if (state == TraceFormatState::Pending)
+			return -1;
+		if (entry.subsystem == subsystem || std::strcmp(entry.subsystem, subsystem) == 0)
+			return state == TraceFormatState::Ready ? static_cast<int>(index) : -1;
+	}
+	return -1;
+}
+
+// Records the format ID, time, thread and raw arguments; the text is only put together by tools/trace_decoder.
+// Returns false when the format can't be traced, for the caller to log it as text.
+bool TraceImpl(const char* subsystem, const char* format, va_list args)
+{
+	if (subsystem == nullptr || subsystem[0] == '\0')
+		subsystem = "Core";
+
+	const int id = FindTraceFormat(subsystem, format);
+	if (id < 0)
+		return false;
+	const TraceFormat& entry = g_traceFormats[id];
+
+	LARGE_INTEGER now = {};
+	QueryPerformanceCounter(&now);
+
+	uint32_t position = 0;
+	LogSlot* slot = ClaimSlot(position);
+	if (slot == nullptr)
+		return true;
+
+	TraceWriter writer = { slot->text, sizeof(ts2fix::TraceRecordHeader) };
+	writer.Put(static_cast<uint16_t>(id));
+	writer.Put(static_cast<uint32_t>(GetCurrentThreadId()));
+	writer.Put(static_cast<int64_t>(now.QuadPart));
+	for (int i = 0; i < entry.argCount; ++i)
+	{
+		switch (entry.kinds[i])
+		{
+		case ts2fix::TraceArgKind::Int32:
+			writer.Put(static_cast<uint32_t>(va_arg(args, unsigned int)));
+			break;
+		case ts2fix::TraceArgKind::Int64:
+			writer.Put(static_cast<uint64_t>(va_arg(args, unsigned long long)));
+			break;
+		case ts2fix::TraceArgKind::Double:
+			writer.Put(va_arg(args, double));
+			break;
+		case ts2fix::TraceArgKind::Pointer:
+			writer.Put(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(va_arg(args, void*))));
+			break;
+		case ts2fix::TraceArgKind::String:
+		{
+			const char* text = va_arg(args, const char*);
+			if (text == nullptr)
+				text = "(null)";
+			const uint8_t length = static_cast<uint8_t>(strnlen(text, ts2fix::kTraceMaxStringBytes));
+			writer.Put(length);
+			writer.PutBytes(text, length);
+			break;
+		}
+		}
+	}
+	writer.Finish(ts2fix::TraceRecordType::Event);
+
+	slot->length = static_cast<uint16_t>(writer.length);
+	slot->kind = LogSlotKind::Trace;
+	PublishSlot(slot, position);
+	return true;
+}
+constexpr uint32_t kRateLimitBurst = 20;
+constexpr uint64_t kRateLimitRefillMs = 1000;
+constexpr uint64_t kRepeatSummaryMs = 10000;
+
+std::atomic<ts2fix::LogRateLimit*> g_rateLimits{nullptr};
+
+uint32_t HashLine(const char* text)
+{
+	uint32_t hash = 2166136261u;
+	for (; *text != '\0'; ++text)
+		hash = (hash ^ static_cast<uint8_t>(*text)) * 16777619u;
+	return hash;
+}
+
+// Caller holds limit.mutex.
+void WriteRateLimitSummary(ts2fix::LogRateLimit& limit, uint64_t nowMs)
+{
+	if (limit.repeats != 0)
+	{
+		ts2fix::Log(limit.subsystem, "last message repeated %u times in %llu ms\n", limit.repeats,
+			static_cast<unsigned long long>(nowMs - limit.firstRepeatMs));
+		limit.repeats = 0;
+	}
+	if (limit.suppressed != 0)
+	{
+		ts2fix::Log(limit.subsystem, "%u messages suppressed by rate limit\n", limit.suppressed);
+		limit.suppressed = 0;
+	}
+}
 
-	char outputBuffer[1024] = {};
-	std::snprintf(outputBuffer, sizeof(outputBuffer), "ToyStory2Fix:%s: %s",
-		(subsystem != nullptr && subsystem[0] != '\0') ? subsystem : "Core",
-		messageBuffer);
-	OutputDebugStringA(outputBuffer);
-	WriteLogLineToFile(outputBuffer);
+void FlushRateLimits()
+{
+	const uint64_t nowMs = GetTickCount64();
+	for (ts2fix::LogRateLimit* limit = g_rateLimits.load(std::memory_order_acquire); limit != nullptr; limit = limit->next)
+	{
+		// At exit a terminated thread may still hold the lock; its site keeps its summary.
+		if (!limit->mutex.try_lock())
+			continue;
+		WriteRateLimitSummary(*limit, nowMs);
+		limit->mutex.unlock();
+	}
 }
 } // namespace
 
 namespace ts2fix
 {
+namespace detail
+{
+std::atomic<uint32_t> g_diagnosticMask{0};
+} // namespace detail
+
 void SetDiagnosticsEnabled(bool enabled)
 {
 	g_diagnosticsEnabled = enabled;
+	UpdateDiagnosticMask();
+}
+
+void SetDiagnosticSubsystems(const std::string& list)
+{
+	uint32_t filter = 0;
+	bool any = false;
+	for (std::size_t start = 0; start <= list.size();)
+	{
+		std::size_t end = list.find(',', start);
+		if (end == std::string::npos)
+			end = list.size();
+
+		std::size_t first = start;
+		std::size_t last = end;
+		while (first < last && std::isspace(static_cast<unsigned char>(list[first])))
+			++first;
+		while (last > first && std::isspace(static_cast<unsigned char>(list[last - 1])))
+			--last;
+
+		if (last > first)
+		{
+			any = true;
+			const LogSubsystem subsystem = FindSubsystem(list.c_str() + first, last - first);
+			if (last - first == 3 && _strnicmp(list.c_str() + first, "all", 3) == 0)
+				filter = ~0u;
+			else if (subsystem == LogSubsystem::Count)
+				Log("Log", "Unknown diagnostic subsystem \"%.*s\" ignored.\n", static_cast<int>(last - first), list.c_str() + first);
+			else
+				filter |= 1u << static_cast<uint32_t>(subsystem);
+		}
+		start = end + 1;
+	}
+
+	g_subsystemFilter = any ? filter : ~0u;
+	UpdateDiagnosticMask();
+}
+
+void SetDiagnosticTraceEnabled(bool enabled)
+{
+	g_traceEnabled = enabled;
 }
 
 bool IsDiagnosticsEnabled()
@@ -129,6 +671,12 @@ bool IsDiagnosticsEnabled()
 	return g_diagnosticsEnabled;
 }
 
+std::string GetLogDirectory()
+{
+	std::call_once(g_logInitOnce, InitializeLogFile);
+	return g_logDirectory;
+}
+
 void Log(const char* subsystem, const char* format, ...)
 {
 	va_list args;
@@ -139,9 +687,84 @@ void Log(const char* subsystem, const char* format, ...)
 
 void LogDiagnostic(const char* subsystem, const char* format, ...)
 {
+	if (!g_diagnosticsEnabled)
+		return;
+
+	LogSubsystem bit = subsystem != nullptr ? FindSubsystem(subsystem, std::strlen(subsystem)) : LogSubsystem::Other;
+	if (bit == LogSubsystem::Count)
+		bit = LogSubsystem::Other;
+	if (!IsDiagnosticEnabled(bit))
+		return;
+
+	va_list args;
+	va_start(args, format);
+	if (!g_traceEnabled || !TraceImpl(subsystem, format, args))
+		LogImpl(true, subsystem, format, args);
+	va_end(args);
+}
+
+void LogLimited(LogRateLimit& limit, const char* subsystem, const char* format, ...)
+{
+	char text[768];
 	va_list args;
 	va_start(args, format);
-	LogImpl(true, subsystem, format, args);
+	std::vsnprintf(text, sizeof(text), format, args);
 	va_end(args);
+
+	const uint32_t hash = HashLine(text);
+	const uint64_t nowMs = GetTickCount64();
+	std::lock_guard<std::mutex> lock(limit.mutex);
+
+	if (limit.subsystem == nullptr)
+	{
+		limit.subsystem = subsystem;
+		limit.tokens = kRateLimitBurst;
+		limit.refillMs = nowMs;
+		limit.lastHash = hash ^ 1u;
+		limit.next = g_rateLimits.load(std::memory_order_relaxed);
+		while (!g_rateLimits.compare_exchange_weak(limit.next, &limit, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	if (hash == limit.lastHash)
+	{
+		if (limit.repeats++ == 0)
+			limit.firstRepeatMs = nowMs;
+		if (nowMs - limit.firstRepeatMs >= kRepeatSummaryMs)
+			WriteRateLimitSummary(limit, nowMs);
+		return;
+	}
+
+	const uint64_t refills = (nowMs - limit.refillMs) / kRateLimitRefillMs;
+	limit.refillMs += refills * kRateLimitRefillMs;
+	limit.tokens = static_cast<uint32_t>(std::min<uint64_t>(kRateLimitBurst, limit.tokens + refills));
+
+	if (limit.tokens == 0)
+	{
+		limit.suppressed += 1;
+		return;
+	}
+
+	limit.tokens -= 1;
+	WriteRateLimitSummary(limit, nowMs);
+	limit.lastHash = hash;
+	Log(subsystem, "%s", text);
+}
+
+void FlushLog()
+{
+	FlushRateLimits();
+	WaitForDrain(kFlushTimeoutMs);
+}
+
+void FlushLogAtProcessExit()
+{
+	FlushRateLimits();
+
+	// Every other thread is gone, the writer possibly killed mid-drain with the flag still set; taking it over can at
+	// worst repeat the lines of that one batch.
+	g_draining.store(false, std::memory_order_release);
+	DrainQueue(true);
 }
 } // namespace ts2fix
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "ts2fix/patches_misc.h"
 #include "ts2fix/logging.h"
+#include "ts2fix/signatures.h"
 
 #include <algorithm>
 
@@ -10,7 +11,7 @@ void ApplyMiscPatches(const Config& config)
 {
 	if (config.compatibility.allow32Bit)
 	{
-		auto pattern = hook::pattern("74 0B 5E 5D B8 01 00 00 00");
+		auto pattern = hook::pattern(signatures::kAllow32Bit);
 		if (!pattern.count_hint(1).empty())
 			injector::WriteMemory<uint8_t>(pattern.get_first(0), '\xEB', true);
 		else
@@ -19,7 +20,7 @@ void ApplyMiscPatches(const Config& config)
 
 	if (config.compatibility.ignoreVRAM)
 	{
-		auto pattern = hook::pattern("74 44 8B 8A 50 01 00 00 8B 91 64 03 00 00");
+		auto pattern = hook::pattern(signatures::kIgnoreVRAM);
 		if (!pattern.count_hint(1).empty())
 			injector::WriteMemory<uint8_t>(pattern.get_first(0), '\xEB', true);
 		else
@@ -28,7 +29,7 @@ void ApplyMiscPatches(const Config& config)
 
 	if (config.compatibility.skipSplash)
 	{
-		auto pattern = hook::pattern("66 8B 3D ? ? ? ? 83 C4 1C");
+		auto pattern = hook::pattern(signatures::kSkipSplash);
 		if (!pattern.count_hint(1).empty())
 		{
 			struct CopyrightHook
@@ -51,7 +52,7 @@ void ApplyMiscPatches(const Config& config)
 		const float renderDistanceScale = std::max(1.0f, config.rendering.renderDistanceScale);
 		const float renderDistanceMax = std::max(0.0f, config.rendering.renderDistanceMax);
 
-		auto pattern = hook::pattern("8B 86 ? ? ? ? 8B 8E ? ? ? ? 50 51 E8 ? ? ? ? 8B 96 ? ? ? ? 8B 86 ? ? ? ? 8B 8E ? ? ? ? 83 C4 08");
+		auto pattern = hook::pattern(signatures::kRenderDistanceTable);
 		if (!pattern.count_hint(1).empty())
 		{
 			auto* renderDistanceTable = reinterpret_cast<float*>(*reinterpret_cast<uint32_t*>(pattern.get_first(8)));
@@ -1,29 +1,95 @@
 #include "stdafx.h"
 #include "ts2fix/pattern_utils.h"
+#include "ts2fix/build_database.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/signature_cache.h"
+#include "ts2fix/signatures.h"
 
-namespace ts2fix
+#include <atomic>
+#include <thread>
+
+namespace
 {
-uintptr_t ResolveRelativeCall(uint8_t* callInstruction)
+// Below this many bytes per chunk, thread startup costs more than the decode.
+constexpr std::size_t kCallsiteChunkMinimum = 256 * 1024;
+
+struct CallsiteEntry
 {
-	const int32_t relativeTarget = *reinterpret_cast<int32_t*>(callInstruction + 1);
-	return reinterpret_cast<uintptr_t>(callInstruction + 5 + relativeTarget);
+	uintptr_t target;
+	uint8_t* instruction;
+	ts2fix::CallsiteKind kind;
+};
+
+struct CallsiteChunk
+{
+	uint8_t* begin; // instruction starts to decode
+	uint8_t* end;
+	uint8_t* limit; // end of the section; decoding never reads past it
+};
+
+std::size_t GetCallsiteLength(ts2fix::CallsiteKind kind)
+{
+	return kind == ts2fix::CallsiteKind::IndirectCall ? 6 : 5;
 }
 
-std::vector<uint8_t*> FindDirectCallsToTarget(uintptr_t targetAddress)
+bool DecodeCallsite(uint8_t* cursor, uint8_t* limit, ts2fix::CallsiteKind& kind, uintptr_t& target)
 {
-	std::vector<uint8_t*> callInstructions;
+	if (cursor + 5 > limit)
+		return false;
+
+	if (cursor[0] == 0xE8 || cursor[0] == 0xE9)
+	{
+		const int32_t relativeTarget = *reinterpret_cast<int32_t*>(cursor + 1);
+		kind = cursor[0] == 0xE8 ? ts2fix::CallsiteKind::RelativeCall : ts2fix::CallsiteKind::RelativeJump;
+		target = reinterpret_cast<uintptr_t>(cursor + 5 + relativeTarget);
+		return true;
+	}
+
+	if (cursor[0] == 0xFF && cursor[1] == 0x15 && cursor + 6 <= limit)
+	{
+		kind = ts2fix::CallsiteKind::IndirectCall;
+		target = *reinterpret_cast<uint32_t*>(cursor + 2);
+		return true;
+	}
+
+	return false;
+}
+
+void IndexCallsiteSpan(const CallsiteChunk& chunk, uintptr_t imageStart, uintptr_t imageEnd, std::vector<CallsiteEntry>& out)
+{
+	for (uint8_t* cursor = chunk.begin; cursor < chunk.end; ++cursor)
+	{
+		ts2fix::CallsiteKind kind;
+		uintptr_t target = 0;
+		if (DecodeCallsite(cursor, chunk.limit, kind, target) && target >= imageStart && target < imageEnd)
+			out.push_back({ target, cursor, kind });
+	}
+}
+
+std::vector<CallsiteEntry> BuildCallsiteIndex()
+{
+	std::vector<CallsiteEntry> index;
 	uint8_t* moduleBase = reinterpret_cast<uint8_t*>(GetModuleHandle(nullptr));
 	if (moduleBase == nullptr)
-		return callInstructions;
+		return index;
 
 	auto* dosHeader = reinterpret_cast<IMAGE_DOS_HEADER*>(moduleBase);
 	if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE)
-		return callInstructions;
+		return index;
 
 	auto* ntHeaders = reinterpret_cast<IMAGE_NT_HEADERS*>(moduleBase + dosHeader->e_lfanew);
 	if (ntHeaders->Signature != IMAGE_NT_SIGNATURE)
-		return callInstructions;
+		return index;
 
+	// Byte-wise decoding also sees operand bytes that merely look like opcodes; keeping only targets
+	// inside the image drops nearly all of those and keeps the table small.
+	const uintptr_t imageStart = reinterpret_cast<uintptr_t>(moduleBase);
+	const uintptr_t imageEnd = imageStart + ntHeaders->OptionalHeader.SizeOfImage;
+
+	// Split the code sections into chunks of instruction starts, through the last one a 5-byte call fits after;
+	// decoding reads up to 5 bytes past a chunk, but never past its section.
+	std::vector<CallsiteChunk> chunks;
+	const unsigned threads = hook::get_scan_threads();
 	IMAGE_SECTION_HEADER* section = IMAGE_FIRST_SECTION(ntHeaders);
 	for (uint16_t i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i, ++section)
 	{
@@ -35,22 +101,100 @@ std::vector<uint8_t*> FindDirectCallsToTarget(uintptr_t targetAddress)
 			continue;
 
 		uint8_t* sectionStart = moduleBase + section->VirtualAddress;
-		uint8_t* sectionEnd = sectionStart + sectionSize - 5;
-		for (uint8_t* cursor = sectionStart; cursor <= sectionEnd; ++cursor)
-		{
-			if (*cursor != 0xE8)
-				continue;
-
-			const int32_t relativeTarget = *reinterpret_cast<int32_t*>(cursor + 1);
-			const uintptr_t destination = reinterpret_cast<uintptr_t>(cursor + 5 + relativeTarget);
-			if (destination == targetAddress)
-				callInstructions.push_back(cursor);
-		}
+		uint8_t* sectionLimit = sectionStart + sectionSize;
+		uint8_t* startsEnd = sectionLimit - 4;
+		const std::size_t chunkSize = std::max<std::size_t>(kCallsiteChunkMinimum, (sectionSize + threads - 1) / threads);
+		for (uint8_t* chunkStart = sectionStart; chunkStart < startsEnd; chunkStart += std::min<std::size_t>(chunkSize, startsEnd - chunkStart))
+			chunks.push_back({ chunkStart, chunkStart + std::min<std::size_t>(chunkSize, startsEnd - chunkStart), sectionLimit });
+	}
+
+	std::vector<std::vector<CallsiteEntry>> chunkEntries(chunks.size());
+	std::atomic<std::size_t> nextChunk(0);
+	auto worker = [&]()
+	{
+		for (std::size_t idx = nextChunk++; idx < chunks.size(); idx = nextChunk++)
+			IndexCallsiteSpan(chunks[idx], imageStart, imageEnd, chunkEntries[idx]);
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads && i < chunks.size(); ++i)
+		pool.emplace_back(worker);
+	worker();
+	for (auto& thread : pool)
+		thread.join();
+
+	for (auto& entries : chunkEntries)
+		index.insert(index.end(), entries.begin(), entries.end());
+
+	std::sort(index.begin(), index.end(), [](const CallsiteEntry& left, const CallsiteEntry& right)
+	{
+		return left.target != right.target ? left.target < right.target : left.instruction < right.instruction;
+	});
+	return index;
+}
+
+const std::vector<CallsiteEntry>& GetCallsiteIndex()
+{
+	static const std::vector<CallsiteEntry> index = []()
+	{
+		LARGE_INTEGER frequency = {};
+		LARGE_INTEGER start = {};
+		LARGE_INTEGER end = {};
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&start);
+
+		std::vector<CallsiteEntry> built = BuildCallsiteIndex();
+
+		QueryPerformanceCounter(&end);
+		const double elapsedMs = frequency.QuadPart != 0
+			? static_cast<double>(end.QuadPart - start.QuadPart) * 1000.0 / static_cast<double>(frequency.QuadPart)
+			: 0.0;
+		ts2fix::Log("Patterns", "Indexed %zu callsites in %.2f ms.\n", built.size(), elapsedMs);
+		return built;
+	}();
+	return index;
+}
+} // namespace
+
+namespace ts2fix
+{
+uintptr_t ResolveRelativeCall(uint8_t* callInstruction)
+{
+	const int32_t relativeTarget = *reinterpret_cast<int32_t*>(callInstruction + 1);
+	return reinterpret_cast<uintptr_t>(callInstruction + 5 + relativeTarget);
+}
+
+std::vector<uint8_t*> FindCallsitesToTarget(uintptr_t targetAddress, CallsiteKind kind)
+{
+	std::vector<uint8_t*> callInstructions;
+	const auto& index = GetCallsiteIndex();
+
+	auto it = std::lower_bound(index.begin(), index.end(), targetAddress, [](const CallsiteEntry& entry, uintptr_t target)
+	{
+		return entry.target < target;
+	});
+
+	for (; it != index.end() && it->target == targetAddress; ++it)
+	{
+		if (it->kind != kind)
+			continue;
+
+		// Hooks installed since the index was built may have retargeted this instruction. It fit in its section when
+		// indexed, so it still does.
+		CallsiteKind currentKind;
+		uintptr_t currentTarget = 0;
+		if (DecodeCallsite(it->instruction, it->instruction + GetCallsiteLength(kind), currentKind, currentTarget) && currentKind == kind && currentTarget == targetAddress)
+			callInstructions.push_back(it->instruction);
 	}
 
 	return callInstructions;
 }
 
+std::vector<uint8_t*> FindDirectCallsToTarget(uintptr_t targetAddress)
+{
+	return FindCallsitesToTarget(targetAddress, CallsiteKind::RelativeCall);
+}
+
 int GetImmediatePushArgBeforeCall(uint8_t* callInstruction)
 {
 	if (callInstruction == nullptr)
@@ -69,4 +213,36 @@ int GetImmediatePushArgBeforeCall(uint8_t* callInstruction)
 
 	return callInstruction[-1];
 }
+
+void PrefetchSignatures(bool saveCache)
+{
+	static bool prefetched = false;
+	if (prefetched)
+		return;
+	prefetched = true;
+
+	LARGE_INTEGER frequency = {};
+	LARGE_INTEGER start = {};
+	LARGE_INTEGER end = {};
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+
+	// A known release needs no scan at all; the cache then only covers offsets that failed verification.
+	ApplyKnownBuildOffsets();
+	const std::size_t cachedEntries = LoadSignatureCache();
+
+	hook::pattern_batch batch;
+	for (const hook::pattern_view& signature : signatures::kInstallSignatures)
+		batch.add(signature);
+	const std::size_t matched = batch.resolve();
+	if (saveCache && batch.scanned() > 0)
+		SaveSignatureCache();
+
+	QueryPerformanceCounter(&end);
+	const double elapsedMs = frequency.QuadPart != 0
+		? static_cast<double>(end.QuadPart - start.QuadPart) * 1000.0 / static_cast<double>(frequency.QuadPart)
+		: 0.0;
+	Log("Patterns", "Resolved %zu/%zu signatures (%zu scanned, %zu cache entries) in %.2f ms on %u thread(s).\n",
+		matched, batch.size(), batch.scanned(), cachedEntries, elapsedMs, hook::get_scan_threads());
+}
 } // namespace ts2fix
@@ -0,0 +1,153 @@
+#include "stdafx.h"
+#include "ts2fix/signature_cache.h"
+#include "ts2fix/image_fingerprint.h"
+#include "ts2fix/logging.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace
+{
+constexpr const char* kCacheFileName = "ToyStory2Fix.sigcache";
+constexpr const char* kCacheHeader = "ToyStory2Fix signature cache v1";
+
+uint64_t ComputeExecutableFingerprint()
+{
+	char exePath[MAX_PATH] = {};
+	if (GetModuleFileNameA(nullptr, exePath, MAX_PATH) == 0)
+		return 0;
+
+	HANDLE file = CreateFileA(exePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return 0;
+
+	uint64_t fingerprint = 0;
+	LARGE_INTEGER fileSize = {};
+	if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && fileSize.HighPart == 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr)
+		{
+			const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view != nullptr)
+			{
+				fingerprint = ts2fix::HashExecutableFile(static_cast<const uint8_t*>(view), static_cast<std::size_t>(fileSize.QuadPart));
+				UnmapViewOfFile(view);
+			}
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+	return fingerprint;
+}
+
+std::string GetCachePath()
+{
+	const std::string directory = ts2fix::GetLogDirectory();
+	return directory.empty() ? std::string{} : directory + kCacheFileName;
+}
+
+uintptr_t GetImageBase()
+{
+	return reinterpret_cast<uintptr_t>(GetModuleHandle(nullptr));
+}
+
+uintptr_t GetImageSize()
+{
+	const auto* base = reinterpret_cast<const uint8_t*>(GetImageBase());
+	const auto* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+	const auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + dosHeader->e_lfanew);
+	return ntHeaders->OptionalHeader.SizeOfImage;
+}
+} // namespace
+
+namespace ts2fix
+{
+uint64_t GetExecutableFingerprint()
+{
+	static const uint64_t fingerprint = ComputeExecutableFingerprint();
+	return fingerprint;
+}
+
+std::size_t LoadSignatureCache()
+{
+	const uint64_t fingerprint = GetExecutableFingerprint();
+	const std::string path = GetCachePath();
+	if (fingerprint == 0 || path.empty())
+		return 0;
+
+	std::FILE* file = std::fopen(path.c_str(), "r");
+	if (file == nullptr)
+		return 0;
+
+	char line[128] = {};
+	uint64_t cachedFingerprint = 0;
+	const bool headerValid =
+		std::fgets(line, sizeof(line), file) != nullptr &&
+		std::strncmp(line, kCacheHeader, std::strlen(kCacheHeader)) == 0 &&
+		std::fgets(line, sizeof(line), file) != nullptr &&
+		std::sscanf(line, "fingerprint %" SCNx64, &cachedFingerprint) == 1;
+
+	if (!headerValid || cachedFingerprint != fingerprint)
+	{
+		std::fclose(file);
+		Log("Patterns", "Signature cache is stale or unreadable; rescanning.\n");
+		return 0;
+	}
+
+	// Entries are only candidates; pattern_batch and pattern::Initialize verify each hint before using it.
+	const uintptr_t imageBase = GetImageBase();
+	const uintptr_t imageSize = GetImageSize();
+	std::size_t loaded = 0;
+	while (std::fgets(line, sizeof(line), file) != nullptr)
+	{
+		uint64_t hash = 0;
+		uint32_t rva = 0;
+		if (std::sscanf(line, "hint %" SCNx64 " %" SCNx32, &hash, &rva) == 2)
+		{
+			if (rva >= imageSize)
+				continue;
+			hook::pattern::hint(hash, imageBase + rva);
+			++loaded;
+		}
+	}
+
+	std::fclose(file);
+	return loaded;
+}
+
+void SaveSignatureCache()
+{
+	const uint64_t fingerprint = GetExecutableFingerprint();
+	const std::string path = GetCachePath();
+	if (fingerprint == 0 || path.empty())
+		return;
+
+	// Write aside and swap so a process loading the cache meanwhile never sees a partial file.
+	const std::string tempPath = path + ".tmp";
+	std::FILE* file = std::fopen(tempPath.c_str(), "w");
+	if (file == nullptr)
+		return;
+
+	std::fprintf(file, "%s\nfingerprint %016" PRIx64 "\n", kCacheHeader, fingerprint);
+
+	const uintptr_t imageBase = GetImageBase();
+	const uintptr_t imageSize = GetImageSize();
+	for (const auto& hint : hook::pattern::get_hints())
+	{
+		if (hint.second < imageBase || hint.second - imageBase >= imageSize)
+			continue;
+		std::fprintf(file, "hint %016" PRIx64 " %08" PRIx32 "\n", hint.first, static_cast<uint32_t>(hint.second - imageBase));
+	}
+
+	const bool written = std::fclose(file) == 0;
+	if (!written || !MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		DeleteFileA(tempPath.c_str());
+		Log("Patterns", "Could not write signature cache %s.\n", path.c_str());
+	}
+}
+} // namespace ts2fix
@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "ts2fix/thread_policy.h"
+#include "ts2fix/logging.h"
+
+#include <vector>
+
+namespace
+{
+using AvSetMmThreadCharacteristicsAFn = HANDLE(WINAPI*)(LPCSTR, LPDWORD);
+
+bool g_configured = false;
+bool g_mmcss = false;
+ts2fix::GameThreadPriority g_priority = ts2fix::GameThreadPriority::Default;
+bool g_gameThreadApplied = false;
+
+// Zero unless core_affinity is on and the CPU mixes core types.
+DWORD_PTR g_performanceCores = 0;
+DWORD_PTR g_efficiencyCores = 0;
+
+int CountCores(DWORD_PTR mask)
+{
+	int count = 0;
+	for (; mask != 0; mask &= mask - 1)
+		count += 1;
+	return count;
+}
+
+// Performance cores report the highest EfficiencyClass, efficiency cores the lowest; on CPUs with one kind of core
+// every core reports the same class and there is nothing to sort. Only processor group 0, the one a 32-bit process
+// runs in.
+void DiscoverCoreTypes()
+{
+	DWORD_PTR processMask = 0;
+	DWORD_PTR systemMask = 0;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+		return;
+
+	DWORD length = 0;
+	GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &length);
+	if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || length == 0)
+		return;
+
+	std::vector<uint8_t> buffer(length);
+	auto* first = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data());
+	if (!GetLogicalProcessorInformationEx(RelationProcessorCore, first, &length))
+		return;
+
+	BYTE minClass = 0xFF;
+	BYTE maxClass = 0;
+	for (DWORD offset = 0; offset < length;)
+	{
+		const auto* info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+		if (info->Processor.GroupMask[0].Group == 0 && (info->Processor.GroupMask[0].Mask & processMask) != 0)
+		{
+			minClass = std::min(minClass, info->Processor.EfficiencyClass);
+			maxClass = std::max(maxClass, info->Processor.EfficiencyClass);
+		}
+		offset += info->Size;
+	}
+
+	if (minClass >= maxClass)
+	{
+		ts2fix::Log("Threads", "All cores are the same kind; core_affinity leaves affinity alone.\n");
+		return;
+	}
+
+	for (DWORD offset = 0; offset < length;)
+	{
+		const auto* info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+		if (info->Processor.GroupMask[0].Group == 0)
+		{
+			const DWORD_PTR mask = static_cast<DWORD_PTR>(info->Processor.GroupMask[0].Mask) & processMask;
+			if (info->Processor.EfficiencyClass == maxClass)
+				g_performanceCores |= mask;
+			else if (info->Processor.EfficiencyClass == minClass)
+				g_efficiencyCores |= mask;
+		}
+		offset += info->Size;
+	}
+
+	ts2fix::Log("Threads", "Hybrid CPU: %d performance and %d efficiency logical processors (masks %p / %p).\n",
+		CountCores(g_performanceCores), CountCores(g_efficiencyCores),
+		reinterpret_cast<void*>(g_performanceCores), reinterpret_cast<void*>(g_efficiencyCores));
+}
+
+void RegisterWithMmcss()
+{
+	// avrt.dll is loaded on demand so the fix still starts where it's missing.
+	HMODULE avrt = LoadLibraryA("avrt.dll");
+	auto setCharacteristics = avrt != nullptr
+		? reinterpret_cast<AvSetMmThreadCharacteristicsAFn>(GetProcAddress(avrt, "AvSetMmThreadCharacteristicsA"))
+		: nullptr;
+	if (setCharacteristics == nullptr)
+	{
+		ts2fix::Log("Threads", "MMCSS unavailable (avrt.dll not found).\n");
+		return;
+	}
+
+	// The registration lasts as long as the thread; the handle is never reverted.
+	DWORD taskIndex = 0;
+	if (setCharacteristics("Games", &taskIndex) == nullptr)
+		ts2fix::Log("Threads", "MMCSS registration failed (%lu).\n", GetLastError());
+	else
+		ts2fix::Log("Threads", "Game thread registered with MMCSS task \"Games\" (index %lu).\n", taskIndex);
+}
+
+const char* GetPriorityName(ts2fix::GameThreadPriority priority)
+{
+	switch (priority)
+	{
+	case ts2fix::GameThreadPriority::AboveNormal:
+		return "above_normal";
+	case ts2fix::GameThreadPriority::Highest:
+		return "highest";
+	default:
+		return "default";
+	}
+}
+} // namespace
+
+namespace ts2fix
+{
+void ConfigureThreadPolicy(const FramerateConfig& config)
+{
+	if (g_configured)
+		return;
+	g_configured = true;
+
+	g_mmcss = config.mmcss;
+	g_priority = config.gameThreadPriority;
+	if (config.coreAffinity)
+		DiscoverCoreTypes();
+}
+
+void ApplyGameThreadPolicy()
+{
+	if (g_gameThreadApplied)
+		return;
+	g_gameThreadApplied = true;
+
+	if (g_mmcss)
+		RegisterWithMmcss();
+
+	if (g_priority != GameThreadPriority::Default)
+	{
+		const int priority = g_priority == GameThreadPriority::Highest ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_ABOVE_NORMAL;
+		if (SetThreadPriority(GetCurrentThread(), priority))
+			Log("Threads", "Game thread priority set to %s.\n", GetPriorityName(g_priority));
+		else
+			Log("Threads", "Could not set game thread priority (%lu).\n", GetLastError());
+	}
+
+	if (g_performanceCores != 0)
+	{
+		if (SetThreadAffinityMask(GetCurrentThread(), g_performanceCores) != 0)
+			Log("Threads", "Game thread kept on performance cores.\n");
+		else
+			Log("Threads", "Could not set game thread affinity (%lu).\n", GetLastError());
+	}
+}
+
+void ApplyHelperThreadPolicy(HANDLE thread)
+{
+	if (g_efficiencyCores == 0 || thread == nullptr)
+		return;
+
+	if (SetThreadAffinityMask(thread, g_efficiencyCores) == 0)
+		TS2FIX_LOG_DIAGNOSTIC(Threads, "Could not move helper thread %lu to efficiency cores (%lu).\n", GetThreadId(thread), GetLastError());
+	else
+		TS2FIX_LOG_DIAGNOSTIC(Threads, "Helper thread %lu moved to efficiency cores.\n", GetThreadId(thread));
+}
+} // namespace ts2fix
@@ -0,0 +1,84 @@
+#include "stdafx.h"
+#include "ts2fix/timer_resolution.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/runtime.h"
+
+#include <MMSystem.h>
+
+namespace
+{
+constexpr int64_t kFocusPollIntervalUs = 250000;
+
+bool g_periodRaised = false;
+UINT g_period = 0;
+int64_t g_nextFocusPollQpc = 0;
+
+bool g_clockAnchored = false;
+int64_t g_clockAnchorQpc = 0;
+DWORD g_clockAnchorMs = 0;
+DWORD g_lastClockMs = 0;
+
+bool IsProcessInForeground()
+{
+	HWND foreground = GetForegroundWindow();
+	if (foreground == nullptr || IsIconic(foreground))
+		return false;
+
+	DWORD processId = 0;
+	GetWindowThreadProcessId(foreground, &processId);
+	return processId == GetCurrentProcessId();
+}
+} // namespace
+
+namespace ts2fix
+{
+void UpdateTimerResolutionSession(int64_t currentQpc)
+{
+	if (g_clockAnchored && currentQpc < g_nextFocusPollQpc)
+		return;
+
+	const auto& runtime = GetRuntimeContext();
+	g_nextFocusPollQpc = currentQpc + (kFocusPollIntervalUs * runtime.performanceFrequency.QuadPart) / 1000000;
+
+	// Re-anchoring on every poll keeps the extrapolated clock from drifting away from timeGetTime.
+	g_clockAnchorQpc = currentQpc;
+	g_clockAnchorMs = timeGetTime();
+	if (!g_clockAnchored)
+		g_lastClockMs = g_clockAnchorMs;
+	g_clockAnchored = true;
+
+	const bool active = IsProcessInForeground();
+	if (active == g_periodRaised)
+		return;
+
+	if (active)
+	{
+		g_period = runtime.timerCaps.wPeriodMin ? runtime.timerCaps.wPeriodMin : 1;
+		timeBeginPeriod(g_period);
+	}
+	else
+	{
+		timeEndPeriod(g_period);
+	}
+
+	g_periodRaised = active;
+	TS2FIX_LOG_DIAGNOSTIC(Timer, "%s timer resolution (%u ms).\n", active ? "Raised" : "Released", g_period);
+}
+
+bool IsTimerResolutionRaised()
+{
+	return g_periodRaised;
+}
+
+DWORD GetSessionTimeMs(int64_t currentQpc)
+{
+	const auto& runtime = GetRuntimeContext();
+	const DWORD timeMs = g_clockAnchorMs +
+		static_cast<DWORD>(((currentQpc - g_clockAnchorQpc) * 1000) / runtime.performanceFrequency.QuadPart);
+
+	// A re-anchor can land a fraction of a millisecond behind the extrapolation; the game only sees time move forward.
+	if (static_cast<int32_t>(timeMs - g_lastClockMs) > 0)
+		g_lastClockMs = timeMs;
+	return g_lastClockMs;
+}
+} // namespace ts2fix
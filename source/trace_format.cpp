@@ -0,0 +1,193 @@
+// Portable: no Windows headers. tools/trace_decoder builds this file on the host.
+#include "ts2fix/trace_format.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace
+{
+enum class LengthModifier
+{
+	None,
+	Long,
+	LongLong,
+	Size,
+	LongDouble,
+};
+
+ts2fix::TraceArgKind IntegerKind(std::size_t size)
+{
+	return size == 8 ? ts2fix::TraceArgKind::Int64 : ts2fix::TraceArgKind::Int32;
+}
+
+// hh/h promote to int; j is 64-bit everywhere we run; MSVC's I64/I32/I are read here too.
+LengthModifier ReadLengthModifier(const char*& p)
+{
+	switch (*p)
+	{
+	case 'h':
+		p += (p[1] == 'h') ? 2 : 1;
+		return LengthModifier::None;
+	case 'l':
+		if (p[1] == 'l')
+		{
+			p += 2;
+			return LengthModifier::LongLong;
+		}
+		p += 1;
+		return LengthModifier::Long;
+	case 'j':
+		p += 1;
+		return LengthModifier::LongLong;
+	case 'z':
+	case 't':
+		p += 1;
+		return LengthModifier::Size;
+	case 'L':
+		p += 1;
+		return LengthModifier::LongDouble;
+	case 'I':
+		if (p[1] == '6' && p[2] == '4')
+		{
+			p += 3;
+			return LengthModifier::LongLong;
+		}
+		if (p[1] == '3' && p[2] == '2')
+		{
+			p += 3;
+			return LengthModifier::None;
+		}
+		p += 1;
+		return LengthModifier::Size;
+	default:
+		return LengthModifier::None;
+	}
+}
+} // namespace
+
+namespace ts2fix
+{
+bool NextTraceConversion(const char*& cursor, TraceConversion& conversion)
+{
+	if (cursor == nullptr || *cursor == '\0')
+		return false;
+
+	conversion = {};
+	conversion.literal = cursor;
+	const char* p = std::strchr(cursor, '%');
+	if (p == nullptr)
+	{
+		conversion.literalLength = std::strlen(cursor);
+		cursor += conversion.literalLength;
+		return true;
+	}
+
+	conversion.literalLength = static_cast<std::size_t>(p - cursor);
+	conversion.spec = p++;
+
+	if (*p == '%')
+	{
+		conversion.conversion = '%';
+		conversion.specLength = 2;
+		cursor = p + 1;
+		return true;
+	}
+
+	while (*p != '\0' && std::strchr("-+ #0", *p) != nullptr)
+		++p;
+
+	if (*p == '*')
+	{
+		conversion.kinds[conversion.kindCount++] = TraceArgKind::Int32;
+		++p;
+	}
+	while (std::isdigit(static_cast<unsigned char>(*p)))
+		++p;
+
+	if (*p == '.')
+	{
+		++p;
+		if (*p == '*')
+		{
+			conversion.kinds[conversion.kindCount++] = TraceArgKind::Int32;
+			++p;
+		}
+		while (std::isdigit(static_cast<unsigned char>(*p)))
+			++p;
+	}
+
+	const LengthModifier length = ReadLengthModifier(p);
+	conversion.conversion = *p;
+	if (*p == '\0')
+	{
+		conversion.kindCount = -1;
+		conversion.specLength = static_cast<std::size_t>(p - conversion.spec);
+		cursor = p;
+		return true;
+	}
+
+	switch (*p)
+	{
+	case 'd':
+	case 'i':
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+	case 'c':
+		if (length == LengthModifier::LongLong)
+			conversion.kinds[conversion.kindCount++] = TraceArgKind::Int64;
+		else if (length == LengthModifier::Long)
+			conversion.kinds[conversion.kindCount++] = IntegerKind(sizeof(long));
+		else if (length == LengthModifier::Size)
+			conversion.kinds[conversion.kindCount++] = IntegerKind(sizeof(std::size_t));
+		else
+			conversion.kinds[conversion.kindCount++] = TraceArgKind::Int32;
+		break;
+	case 'f':
+	case 'F':
+	case 'e':
+	case 'E':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		// long double only matches double under MSVC; not worth carrying.
+		if (length == LengthModifier::LongDouble)
+			conversion.kindCount = -1;
+		else
+			conversion.kinds[conversion.kindCount++] = TraceArgKind::Double;
+		break;
+	case 's':
+		if (length != LengthModifier::None)
+			conversion.kindCount = -1;
+		else
+			conversion.kinds[conversion.kindCount++] = TraceArgKind::String;
+		break;
+	case 'p':
+		conversion.kinds[conversion.kindCount++] = TraceArgKind::Pointer;
+		break;
+	default:
+		conversion.kindCount = -1;
+		break;
+	}
+
+	conversion.specLength = static_cast<std::size_t>(p + 1 - conversion.spec);
+	cursor = p + 1;
+	return true;
+}
+
+int ParseTraceArgKinds(const char* format, TraceArgKind* kinds, int maxKinds)
+{
+	int count = 0;
+	TraceConversion conversion;
+	while (NextTraceConversion(format, conversion))
+	{
+		if (conversion.kindCount < 0 || count + conversion.kindCount > maxKinds)
+			return -1;
+		for (int i = 0; i < conversion.kindCount; ++i)
+			kinds[count++] = conversion.kinds[i];
+	}
+	return count;
+}
+} // namespace ts2fix
@@ -0,0 +1,156 @@
+#include "stdafx.h"
+#include "ts2fix/vblank_clock.h"
+#include "ts2fix/logging.h"
+#include "ts2fix/runtime.h"
+#include "ts2fix/vblank_pll.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+// More failed waits in a row than this and the display is taken to have no usable vblank.
+constexpr uint32_t kMaxFailedWaits = 50;
+constexpr DWORD kFailedWaitSleepMs = 100;
+
+// The work estimate follows a sixteenth of each new measurement.
+constexpr int64_t kWorkSmoothing = 16;
+
+bool g_enabled = false;
+int64_t g_marginUs = 1500;
+
+ts2fix::VblankWaitFn g_wait = nullptr;
+void* g_waitContext = nullptr;
+HANDLE g_samplerThread = nullptr;
+
+// Written by the sampler thread, read by the game thread. Readers retry while the sequence is odd.
+std::atomic<uint32_t> g_sequence{ 0 };
+ts2fix::VblankEstimate g_published = {};
+
+int64_t g_workEstimateUs = 0; // game thread only
+
+void PublishEstimate(const ts2fix::VblankEstimate& estimate)
+{
+	g_sequence.fetch_add(1, std::memory_order_acq_rel);
+	g_published = estimate;
+	g_sequence.fetch_add(1, std::memory_order_release);
+}
+
+bool ReadEstimate(ts2fix::VblankEstimate& estimate)
+{
+	for (int attempt = 0; attempt < 4; ++attempt)
+	{
+		const uint32_t before = g_sequence.load(std::memory_order_acquire);
+		if ((before & 1) != 0)
+			continue;
+		estimate = g_published;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (g_sequence.load(std::memory_order_relaxed) == before)
+			return true;
+	}
+	return false;
+}
+
+DWORD WINAPI VblankSamplerThread(LPVOID)
+{
+	ts2fix::VblankPll pll;
+	bool wasLocked = false;
+	uint32_t failedWaits = 0;
+	const double frequency = static_cast<double>(ts2fix::GetRuntimeContext().performanceFrequency.QuadPart);
+
+	for (;;)
+	{
+		if (!g_wait(g_waitContext))
+		{
+			failedWaits += 1;
+			if (failedWaits >= kMaxFailedWaits)
+			{
+				ts2fix::Log("Vblank", "Vertical blank waits keep failing; frame deadlines stay unaligned.\n");
+				PublishEstimate(ts2fix::VblankEstimate());
+				return 0;
+			}
+			Sleep(kFailedWaitSleepMs);
+			continue;
+		}
+		failedWaits = 0;
+
+		LARGE_INTEGER now = {};
+		QueryPerformanceCounter(&now);
+		pll.AddSample(now.QuadPart);
+
+		const ts2fix::VblankEstimate& estimate = pll.GetEstimate();
+		PublishEstimate(estimate);
+		if (estimate.locked != wasLocked)
+		{
+			wasLocked = estimate.locked;
+			if (wasLocked)
+			{
+				ts2fix::Log("Vblank", "Locked to the display: %.1f us per refresh (%.3f Hz).\n",
+					estimate.periodQpc * 1000000.0 / frequency, frequency / estimate.periodQpc);
+			}
+			else
+			{
+				ts2fix::Log("Vblank", "Lost vblank lock; reacquiring.\n");
+			}
+		}
+	}
+}
+} // namespace
+
+namespace ts2fix
+{
+void ConfigureVblankClock(const FramerateConfig& config)
+{
+	g_enabled = config.vblankLock;
+	g_marginUs = static_cast<int64_t>(config.vblankMarginUs);
+}
+
+bool IsVblankClockEnabled()
+{
+	return g_enabled;
+}
+
+bool StartVblankClock(VblankWaitFn wait, void* context)
+{
+	if (!g_enabled || wait == nullptr)
+		return false;
+	if (g_samplerThread != nullptr)
+		return true;
+
+	g_wait = wait;
+	g_waitContext = context;
+	g_samplerThread = CreateThread(nullptr, 0, VblankSamplerThread, nullptr, 0, nullptr);
+	if (g_samplerThread == nullptr)
+	{
+		Log("Vblank", "Failed to start the vblank sampler (%lu).\n", GetLastError());
+		return false;
+	}
+
+	// The thread sleeps in the vblank wait; running ahead of the game keeps its timestamps close to the real edge.
+	SetThreadPriority(g_samplerThread, THREAD_PRIORITY_HIGHEST);
+	Log("Vblank", "Vblank sampler started (margin %lld us).\n", static_cast<long long>(g_marginUs));
+	return true;
+}
+
+int64_t AlignFrameDeadlineToVblank(int64_t deadlineQpc, int64_t frameDurationQpc, int64_t gameWorkUs)
+{
+	if (!g_enabled || g_samplerThread == nullptr)
+		return deadlineQpc;
+
+	// A frame that ran long (loading, alt-tab) counts as one whole frame of work, so it can't drag the lead past that.
+	const int64_t frequency = GetRuntimeContext().performanceFrequency.QuadPart;
+	const int64_t frameDurationUs = (frameDurationQpc * 1000000) / frequency;
+	const int64_t workUs = std::min(gameWorkUs, frameDurationUs);
+	if (g_workEstimateUs == 0)
+		g_workEstimateUs = workUs;
+	else
+		g_workEstimateUs += (workUs - g_workEstimateUs) / kWorkSmoothing;
+
+	VblankEstimate estimate;
+	if (!ReadEstimate(estimate))
+		return deadlineQpc;
+
+	const int64_t leadQpc = std::min(((g_workEstimateUs + g_marginUs) * frequency) / 1000000, frameDurationQpc);
+	return AlignDeadlineToVblank(estimate, deadlineQpc, frameDurationQpc, leadQpc);
+}
+} // namespace ts2fix
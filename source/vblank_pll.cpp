@@ -0,0 +1,91 @@
+// Portable: no Windows headers. tools/frame_timer_replay builds this file on the host.
+#include "ts2fix/vblank_pll.h"
+
+#include <cmath>
+
+namespace
+{
+// Consecutive intervals averaged for the first period estimate.
+constexpr uint32_t kAcquireSamples = 16;
+// Tracked samples before deadlines are aligned.
+constexpr uint32_t kLockSamples = 32;
+constexpr uint32_t kMaxOutliers = 8;
+// More missed vblanks than this between samples and the phase is taken afresh.
+constexpr int64_t kMaxMissedCycles = 8;
+
+// Second-order loop: the phase follows a fifth of each error, the period a fiftieth of it.
+constexpr double kPhaseGain = 0.2;
+constexpr double kPeriodGain = 0.02;
+
+constexpr double kOutlierFraction = 0.25;
+constexpr double kWholeRefreshTolerance = 0.05;
+} // namespace
+
+namespace ts2fix
+{
+void VblankPll::Reset()
+{
+	*this = VblankPll();
+}
+
+void VblankPll::AddSample(int64_t vblankQpc)
+{
+	if (m_acquireSamples < kAcquireSamples)
+	{
+		if (m_acquireSamples == 0)
+			m_acquireStartQpc = vblankQpc;
+		m_acquireSamples += 1;
+		if (m_acquireSamples == kAcquireSamples)
+		{
+			m_estimate.periodQpc = static_cast<double>(vblankQpc - m_acquireStartQpc) / (kAcquireSamples - 1);
+			m_estimate.phaseQpc = vblankQpc;
+			if (m_estimate.periodQpc <= 0.0)
+				Reset();
+		}
+		return;
+	}
+
+	const double sinceLast = static_cast<double>(vblankQpc - m_estimate.phaseQpc);
+	const int64_t cycles = std::llround(sinceLast / m_estimate.periodQpc);
+	if (cycles < 1)
+		return;
+	if (cycles > kMaxMissedCycles)
+	{
+		m_estimate.phaseQpc = vblankQpc;
+		return;
+	}
+
+	const double predicted = m_estimate.phaseQpc + cycles * m_estimate.periodQpc;
+	const double error = static_cast<double>(vblankQpc) - predicted;
+	if (std::fabs(error) > m_estimate.periodQpc * kOutlierFraction)
+	{
+		m_outliers += 1;
+		if (m_outliers >= kMaxOutliers)
+			Reset();
+		return;
+	}
+
+	m_outliers = 0;
+	m_estimate.phaseQpc = static_cast<int64_t>(std::llround(predicted + kPhaseGain * error));
+	m_estimate.periodQpc += kPeriodGain * error / static_cast<double>(cycles);
+	if (m_trackedSamples < kLockSamples)
+		m_trackedSamples += 1;
+	m_estimate.locked = m_trackedSamples >= kLockSamples;
+}
+
+int64_t AlignDeadlineToVblank(const VblankEstimate& estimate, int64_t deadlineQpc, int64_t frameDurationQpc, int64_t leadQpc)
+{
+	if (!estimate.locked || estimate.periodQpc <= 0.0)
+		return deadlineQpc;
+
+	// 60 FPS on a 120 Hz panel aligns to every other vblank; 100 FPS on 144 Hz doesn't align at all.
+	const double refreshes = std::round(frameDurationQpc / estimate.periodQpc);
+	if (refreshes < 1.0 || std::fabs(frameDurationQpc - refreshes * estimate.periodQpc) > estimate.periodQpc * kWholeRefreshTolerance)
+		return deadlineQpc;
+
+	const double readyQpc = static_cast<double>(deadlineQpc + leadQpc);
+	const double nearestCycle = std::round((readyQpc - estimate.phaseQpc) / estimate.periodQpc);
+	const double vblankQpc = estimate.phaseQpc + nearestCycle * estimate.periodQpc;
+	return static_cast<int64_t>(std::llround(vblankQpc)) - leadQpc;
+}
+} // namespace ts2fix
@@ -3,6 +3,7 @@
 #include "ts2fix/logging.h"
 #include "ts2fix/pattern_utils.h"
 #include "ts2fix/runtime.h"
+#include "ts2fix/signatures.h"
 
 namespace ts2fix
 {
@@ -18,7 +19,7 @@ int WidescreenHook()
 
 	if (!resolutionPointerLookupAttempted)
 	{
-		auto pattern = hook::pattern("8B 15 ? ? ? ? 89 4C 24 08 89 44 24 0C");
+		auto pattern = hook::pattern(signatures::kWidescreenResolution);
 		if (!pattern.count_hint(1).empty())
 			resolution = *reinterpret_cast<uint32_t**>(pattern.get_first(2));
 		resolutionPointerLookupAttempted = true;
@@ -40,7 +41,7 @@ int WidescreenHook()
 	if (!widescreen3DHookAttempted)
 	{
 		widescreen3DHookAttempted = true;
-		auto pattern = hook::pattern("C7 40 44 00 00 40 3F");
+		auto pattern = hook::pattern(signatures::kWidescreen3DScale);
 		if (!pattern.count_hint(1).empty())
 		{
 			struct Widescreen3DHook
@@ -60,7 +61,7 @@ int WidescreenHook()
 
 bool InstallWidescreenHook()
 {
-	auto pattern = hook::pattern("8D 44 24 10 50 57 E8 ? ? ? ? 83");
+	auto pattern = hook::pattern(signatures::kWidescreenCall);
 	if (pattern.count_hint(1).empty())
 	{
 		Log("Widescreen", "Pattern not found; widescreen hook skipped.\n");
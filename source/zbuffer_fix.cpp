@@ -3,6 +3,7 @@
 
 #include "ts2fix/logging.h"
 #include "ts2fix/pattern_utils.h"
+#include "ts2fix/signatures.h"
 
 namespace
 {
@@ -57,14 +58,7 @@ bool PatchProjectionDepthRange()
 {
 	// This block initializes projection defaults:
 	// [ptr+0x48] = 50.0f (near), [ptr+0x4C] = 32768.0f (far).
-	auto pattern = hook::pattern(
-		"C7 40 44 00 00 40 3F "
-		"8B 0D ? ? ? ? "
-		"C7 41 40 00 00 A0 3F "
-		"8B 15 ? ? ? ? "
-		"C7 42 4C 00 00 00 47 "
-		"A1 ? ? ? ? "
-		"C7 40 48 00 00 48 42");
+	auto pattern = hook::pattern(ts2fix::signatures::kProjectionDepthRange);
 
 	if (pattern.count_hint(1).empty())
 	{
@@ -100,7 +94,7 @@ bool InstallZBufferFixHook(const RenderingConfig& renderingConfig)
 	const bool projectionPatched = PatchProjectionDepthRange();
 
 	// The depth-state function contains SetRenderState calls for ZENABLE (7), ZWRITEENABLE (14), and ZFUNC (23).
-	auto pattern = hook::pattern("66 83 3D ? ? ? ? 02 56 8B 35 ? ? ? ? 0F 85 ? ? ? ? A1 ? ? ? ? 85 C0");
+	auto pattern = hook::pattern(signatures::kDepthStateFunction);
 	if (pattern.count_hint(1).empty())
 	{
 		Log("ZBuffer", "Depth-state function pattern not found; z-buffer fix skipped.\n");
@@ -2,6 +2,7 @@
 #include "ts2fix/zero_speed_safety.h"
 #include "ts2fix/logging.h"
 #include "ts2fix/runtime.h"
+#include "ts2fix/signatures.h"
 
 #include <algorithm>
 #include <cstdint>
@@ -51,7 +52,7 @@ bool InstallZeroSpeedSafetyPatches()
 	bool hasRenderDeltaPatch = false;
 	bool hasRenderMotionPatch = false;
 
-	auto pattern = hook::pattern("8B 46 68 8B 56 70 0F AF 05 ? ? ? ? 89 46 68 8B 0D ? ? ? ? 0F AF 4E 6C 89 4E 6C 0F AF 15 ? ? ? ?");
+	auto pattern = hook::pattern(signatures::kSafetyMultiply);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEaxBySafeSpeedHook
@@ -84,7 +85,7 @@ bool InstallZeroSpeedSafetyPatches()
 		hasMulPatch = true;
 	}
 
-	pattern = hook::pattern("8B 46 68 83 C4 08 99 F7 3D ? ? ? ? 89 46 68 8B 46 6C 99 F7 3D ? ? ? ? 89 46 6C 8B 46 70 99 F7 3D ? ? ? ?");
+	pattern = hook::pattern(signatures::kSafetyDivide);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct DivBySafeSpeedHook
@@ -101,7 +102,7 @@ bool InstallZeroSpeedSafetyPatches()
 		hasDivPatch = true;
 	}
 
-	pattern = hook::pattern("B8 1E 00 00 00 53 99 F7 3D ? ? ? ? 56 57");
+	pattern = hook::pattern(signatures::kSafetyMenuDivide);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct DivBySafeSpeedHook
@@ -115,7 +116,7 @@ bool InstallZeroSpeedSafetyPatches()
 		hasMenuDivPatch = true;
 	}
 
-	pattern = hook::pattern("8B 0D ? ? ? ? B8 B7 60 0B B6 C1 E1 10 F7 E9 03 D1 C1 FA 08 8B C2 C1 E8 1F 03 D0 52 E8 ? ? ? ? 83 C4 0C");
+	pattern = hook::pattern(signatures::kSafetyRenderDelta);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct LoadRenderSafeSpeedHook
@@ -130,7 +131,7 @@ bool InstallZeroSpeedSafetyPatches()
 	}
 
 	bool hasRenderMotionPatchA = false;
-	pattern = hook::pattern("8B C1 2B C2 0F AF 05 ? ? ? ? 99 83 E2 0F 03 C2 C1 F8 04 2B C8 89 4F 04 8B 4F 08 8B 15 ? ? ? ? 8B C1 2B C2 0F AF 05 ? ? ? ? 99 83 E2 0F");
+	pattern = hook::pattern(signatures::kSafetyRenderMotionA);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEaxBySafeSpeedHook
@@ -146,7 +147,7 @@ bool InstallZeroSpeedSafetyPatches()
 	}
 
 	bool hasRenderMotionPatchB = false;
-	pattern = hook::pattern("8B 46 6C 0F AF 05 ? ? ? ? 99 83 E2 0F 03 C2 C1 F8 04 66 01 46 0E");
+	pattern = hook::pattern(signatures::kSafetyRenderMotionB);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEaxBySafeSpeedHook
@@ -161,7 +162,7 @@ bool InstallZeroSpeedSafetyPatches()
 	}
 
 	bool hasRenderMotionPatchC = false;
-	pattern = hook::pattern("C1 F8 03 0F AF 05 ? ? ? ? 99 2B C2 8B D0 66 8B 45 0E D1 FA 66 2B C2");
+	pattern = hook::pattern(signatures::kSafetyRenderMotionC);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEaxBySafeSpeedHook
@@ -176,7 +177,7 @@ bool InstallZeroSpeedSafetyPatches()
 	}
 
 	bool hasRenderMotionPatchD = false;
-	pattern = hook::pattern("8B D1 0F AF 15 ? ? ? ? 03 C2 8B 15 ? ? ? ? 3B C2");
+	pattern = hook::pattern(signatures::kSafetyRenderMotionD);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEdxBySafeSpeedHook
@@ -191,7 +192,7 @@ bool InstallZeroSpeedSafetyPatches()
 	}
 
 	bool hasRenderMotionPatchE = false;
-	pattern = hook::pattern("33 C0 8A C1 8B 54 24 ? D1 E8 83 C0 05 83 C4 10 0F AF 05 ? ? ? ? 03 D0 83 FA 10");
+	pattern = hook::pattern(signatures::kSafetyRenderMotionE);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEaxBySafeSpeedHook
@@ -206,7 +207,7 @@ bool InstallZeroSpeedSafetyPatches()
 	}
 
 	bool hasRenderMotionPatchF = false;
-	pattern = hook::pattern("33 C0 56 A0 ? ? ? ? 57 0F AF 05 ? ? ? ? 99 2B C2 33 FF 8B F0 D1 FE");
+	pattern = hook::pattern(signatures::kSafetyRenderMotionF);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEaxBySafeSpeedHook
@@ -221,7 +222,7 @@ bool InstallZeroSpeedSafetyPatches()
 	}
 
 	bool hasRenderMotionPatchG = false;
-	pattern = hook::pattern("A1 ? ? ? ? 66 8B 15 ? ? ? ? C1 F8 04 0F AF 05 ? ? ? ? 8B 0D ? ? ? ? 83 C4 28");
+	pattern = hook::pattern(signatures::kSafetyRenderMotionG);
 	if (!pattern.count_hint(1).empty())
 	{
 		struct MulEaxBySafeSpeedHook
@@ -0,0 +1,546 @@
+// Frame-timer replay: drives the frame-timer state machine (source/frame_timer_core.cpp) with a virtual clock and
+// scripted per-frame game costs, then checks step counts, simulation drift and mode transitions and reports pacing
+// error statistics. Scenarios with a display also model when each frame reaches the screen, and can lock deadlines to
+// the virtual vblank through source/vblank_pll.cpp. Runs on the host, no game needed; exits non-zero when a scenario
+// misses its expectations.
+
+#include "ts2fix/frame_timer_core.h"
+#include "ts2fix/vblank_pll.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace
+{
+using ts2fix::FrameTimerCallsite;
+using ts2fix::FrameTimerMode;
+
+// Same tick rate Windows reports for QueryPerformanceCounter on invariant-TSC machines.
+constexpr int64_t kCounterFrequency = 10000000;
+
+int64_t UsToCounter(int64_t us)
+{
+	return (us * kCounterFrequency) / 1000000;
+}
+
+int64_t CounterToUs(int64_t counter)
+{
+	return (counter * 1000000) / kCounterFrequency;
+}
+
+struct ModeTransition
+{
+	uint32_t frame;
+	FrameTimerMode from;
+	FrameTimerMode to;
+	const char* reason;
+};
+
+// A deterministic stand-in for QPC, Sleep and the game's globals. Waits wake late by a seeded, Sleep-like amount.
+class VirtualEnvironment final : public ts2fix::FrameTimerEnvironment
+{
+public:
+	explicit VirtualEnvironment(uint32_t seed) : m_random(seed) {}
+
+	int64_t QueryCounter() override
+	{
+		return m_counterFrozen ? m_frozenCounter : m_counter;
+	}
+
+	int64_t GetCounterFrequency() override
+	{
+		return kCounterFrequency;
+	}
+
+	void BeginFrame(int64_t) override {}
+
+	ts2fix::PacingWaitSplit WaitForDeadline(int64_t deadlineQpc, int) override
+	{
+		ts2fix::PacingWaitSplit split;
+		if (m_counter >= deadlineQpc)
+			return split;
+
+		// Mostly 20-150 us late, like a well-behaved timer wait; one wait in a hundred misses by a millisecond.
+		const uint32_t roll = m_random();
+		const int64_t lateUs = (roll % 100) == 0 ? 1000 : 20 + static_cast<int64_t>((roll >> 8) % 131);
+		split.blockedUs = CounterToUs(deadlineQpc - m_counter) + lateUs;
+		m_counter = deadlineQpc + UsToCounter(lateUs);
+		return split;
+	}
+
+	// Stands in for vblank_clock.cpp: the sampler thread's timestamps, up to now, then the same alignment.
+	int64_t AlignDeadline(int64_t deadlineQpc, int64_t frameDurationQpc, int64_t gameWorkUs) override
+	{
+		if (!vblankLock)
+			return deadlineQpc;
+
+		while (m_nextVblankQpc <= m_counter)
+		{
+			// The sampler wakes up to 50 us after the real edge.
+			m_pll.AddSample(static_cast<int64_t>(m_nextVblankQpc) + UsToCounter(m_random() % 51));
+			m_nextVblankQpc += vblankPeriodQpc;
+		}
+
+		const int64_t workUs = std::min(gameWorkUs, CounterToUs(frameDurationQpc));
+		m_workEstimateUs = m_workEstimateUs == 0 ? workUs : m_workEstimateUs + (workUs - m_workEstimateUs) / 16;
+		const int64_t leadQpc = std::min(UsToCounter(m_workEstimateUs + kVblankMarginUs), frameDurationQpc);
+		return ts2fix::AlignDeadlineToVblank(m_pll.GetEstimate(), deadlineQpc, frameDurationQpc, leadQpc);
+	}
+
+	uint32_t GetTimeMs(int64_t currentQpc) override
+	{
+		return static_cast<uint32_t>(CounterToUs(currentQpc) / 1000);
+	}
+
+	bool IsStartupGuardActive() override
+	{
+		return false;
+	}
+
+	bool IsGameInBackground() override
+	{
+		return inBackground;
+	}
+
+	void OnModeChanged(FrameTimerCallsite, FrameTimerMode oldMode, const ts2fix::FrameTimerState& state, const char* reason) override
+	{
+		transitions.push_back({ frameIndex, oldMode, state.mode, reason });
+	}
+
+	uint32_t* GetSpeedMultiplier() override
+	{
+		return &speedMultiplier;
+	}
+
+	bool* GetIsDemoMode() override
+	{
+		return &isDemoMode;
+	}
+
+	void AdvanceUs(int64_t us)
+	{
+		m_counter += UsToCounter(us);
+	}
+
+	// A counter that stops moving, as seen on some broken virtual machines.
+	void SetCounterFrozen(bool frozen)
+	{
+		if (frozen && !m_counterFrozen)
+			m_frozenCounter = m_counter;
+		m_counterFrozen = frozen;
+	}
+
+	// vblank_margin_us default.
+	static constexpr int64_t kVblankMarginUs = 1500;
+
+	// The virtual display: vblank k starts at vblankOriginQpc + k * vblankPeriodQpc. Zero period means no display.
+	double vblankOriginQpc = 0.0;
+	double vblankPeriodQpc = 0.0;
+	bool vblankLock = false;
+
+	uint32_t speedMultiplier = 1;
+	bool isDemoMode = false;
+	bool inBackground = false;
+	uint32_t frameIndex = 0;
+	std::vector<ModeTransition> transitions;
+
+private:
+	std::mt19937 m_random;
+	int64_t m_counter = UsToCounter(1000000);
+	int64_t m_frozenCounter = 0;
+	bool m_counterFrozen = false;
+	ts2fix::VblankPll m_pll;
+	double m_nextVblankQpc = 0.0;
+	int64_t m_workEstimateUs = 0;
+
+public:
+	void StartDisplay(double refreshHz, bool lock)
+	{
+		vblankPeriodQpc = kCounterFrequency / refreshHz;
+		vblankOriginQpc = static_cast<double>(m_counter) + UsToCounter(1234);
+		vblankLock = lock;
+		m_nextVblankQpc = vblankOriginQpc;
+	}
+};
+
+struct Scenario
+{
+	const char* name;
+	const char* description;
+	uint32_t refreshHz;
+	bool zeroSpeedSafetyReady;
+	bool demoMode;
+	// Game work for frame i in microseconds, outside the frame timer.
+	std::function<int64_t(uint32_t frame)> frameCostUs;
+	// Frames during which the virtual counter is frozen, [begin, end).
+	uint32_t frozenBegin;
+	uint32_t frozenEnd;
+	// Frames paced at backgroundFps, as while the game is unfocused, [begin, end).
+	uint32_t backgroundBegin;
+	uint32_t backgroundEnd;
+	uint32_t backgroundFps;
+	// Real refresh rate of the virtual display, which can differ from refreshHz as real panels do, or 0 for none.
+	double displayHz;
+	bool vblankLock;
+
+	// Expectations.
+	FrameTimerMode expectedFinalMode;
+	std::size_t expectedTransitions;
+	double maxDriftSteps;  // |simulated time - wall time| at the end, in 60 Hz steps
+	double maxP99ErrorUs;  // frame end minus deadline, 99th percentile
+	int fixedSteps;        // every paced frame must give exactly this many steps, or -1
+	bool expectResync;     // frames after the longest frame must not run back to back
+	int maxRepeatedRefreshes; // refreshes that showed the previous frame again, or -1
+};
+
+struct ScenarioResult
+{
+	uint32_t frames = 0;
+	uint32_t pacedFrames = 0;
+	uint64_t steps = 0;
+	uint32_t zeroStepFrames = 0;
+	bool fixedStepsHeld = true;
+	double driftSteps = 0.0;
+	double meanIntervalUs = 0.0;
+	double p50ErrorUs = 0.0;
+	double p99ErrorUs = 0.0;
+	double maxErrorUs = 0.0;
+	double blockedUsPerFrame = 0.0;
+	uint32_t burstFramesAfterStall = 0;
+	uint32_t repeatedRefreshes = 0; // a refresh with no new frame
+	uint32_t droppedFrames = 0;     // a frame replaced before it reached the screen
+	double nsPerFrame = 0.0;
+	FrameTimerMode finalMode = FrameTimerMode::LegacyPassthrough;
+	std::vector<ModeTransition> transitions;
+};
+
+double Percentile(std::vector<double> values, double fraction)
+{
+	if (values.empty())
+		return 0.0;
+	const std::size_t index = static_cast<std::size_t>((values.size() - 1) * fraction);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+ScenarioResult RunScenario(const Scenario& scenario, double seconds, uint32_t seed)
+{
+	VirtualEnvironment environment(seed);
+	environment.isDemoMode = scenario.demoMode;
+	if (scenario.displayHz > 0.0)
+		environment.StartDisplay(scenario.displayHz, scenario.vblankLock);
+
+	ts2fix::FrameTimerTuning tuning;
+	tuning.targetFrameTimeUs = static_cast<int>((1000000 + scenario.refreshHz / 2) / scenario.refreshHz);
+	tuning.zeroSpeedSafetyReady = scenario.zeroSpeedSafetyReady;
+	tuning.autoFallbackTo60 = true;
+	tuning.backgroundFrameTimeUs = scenario.backgroundFps != 0 ? static_cast<int>(1000000 / scenario.backgroundFps) : 0;
+	bool backgroundCapped = false;
+
+	// Gameplay callsite, set up the way InitializeFrameTimerModes does it.
+	const FrameTimerCallsite callsite = FrameTimerCallsite::Gameplay;
+	ts2fix::FrameTimerState state;
+	ts2fix::SetFrameTimerMode(environment, callsite, state, ts2fix::GetPreferredGameplayMode(tuning), "initial setup");
+
+	ScenarioResult result;
+	std::vector<double> errorsUs;
+	int64_t lastEndQpc = 0;
+	int64_t previousEndQpc = 0;
+	int64_t blockedUs = 0;
+	int64_t longestFrameUs = 0;
+	uint32_t longestFrame = 0;
+	std::vector<int64_t> intervalsUs;
+	int64_t lastShownVblank = -1;
+
+	const int64_t durationUs = static_cast<int64_t>(seconds * 1000000.0);
+	const auto wallStart = std::chrono::steady_clock::now();
+	for (uint32_t frame = 0;; ++frame)
+	{
+		environment.frameIndex = frame;
+		environment.SetCounterFrozen(frame >= scenario.frozenBegin && frame < scenario.frozenEnd);
+
+		const int64_t costUs = scenario.frameCostUs(frame);
+		environment.AdvanceUs(costUs);
+
+		// The previous frame is flipped once its work is done and shows from the next vblank on. Frames are only
+		// counted once the timing has settled, so the PLL's acquisition doesn't count against it.
+		if (environment.vblankPeriodQpc > 0.0 && frame > 0)
+		{
+			const double sinceOrigin = static_cast<double>(environment.QueryCounter()) - environment.vblankOriginQpc;
+			const int64_t shownVblank = static_cast<int64_t>(std::ceil(sinceOrigin / environment.vblankPeriodQpc));
+			if (lastShownVblank >= 0 && CounterToUs(environment.QueryCounter() - UsToCounter(1000000)) >= 2000000)
+			{
+				if (shownVblank == lastShownVblank)
+					result.droppedFrames += 1;
+				else
+					result.repeatedRefreshes += static_cast<uint32_t>(shownVblank - lastShownVblank - 1);
+			}
+			lastShownVblank = shownVblank;
+		}
+		if (costUs > longestFrameUs)
+		{
+			longestFrameUs = costUs;
+			longestFrame = frame;
+		}
+
+		if (state.mode == FrameTimerMode::LegacyPassthrough)
+		{
+			// FrameTimerHook hands these calls to the game's own timer, which steps once per call.
+			result.steps += 1;
+		}
+		else
+		{
+			environment.inBackground = frame >= scenario.backgroundBegin && frame < scenario.backgroundEnd;
+			ts2fix::FrameTimerTuning frameTuning = tuning;
+			ts2fix::ApplyBackgroundCap(environment, frameTuning, backgroundCapped);
+
+			const bool allowZeroStepSimulation = state.mode == FrameTimerMode::CustomZeroStep &&
+				frameTuning.zeroSpeedSafetyReady && frameTuning.targetFrameTimeUs < ts2fix::kGameplayFrameTimeUs;
+			const ts2fix::FrameTimerFrame paced = ts2fix::RunFrameTimerFrame(environment, frameTuning, callsite, state, allowZeroStepSimulation);
+
+			result.pacedFrames += 1;
+			result.steps += static_cast<uint64_t>(paced.speedMultiplier);
+			result.zeroStepFrames += paced.speedMultiplier == 0 ? 1 : 0;
+			if (scenario.fixedSteps >= 0 && paced.speedMultiplier != scenario.fixedSteps)
+				result.fixedStepsHeld = false;
+			errorsUs.push_back(static_cast<double>(CounterToUs(paced.frameEndQpc - paced.deadlineQpc)));
+			blockedUs += paced.wait.blockedUs;
+		}
+
+		const int64_t endQpc = environment.QueryCounter();
+		if (previousEndQpc != 0)
+			intervalsUs.push_back(CounterToUs(endQpc - previousEndQpc));
+		previousEndQpc = endQpc;
+		lastEndQpc = endQpc;
+		result.frames = frame + 1;
+
+		if (CounterToUs(lastEndQpc - UsToCounter(1000000)) >= durationUs)
+			break;
+	}
+	const double wallNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wallStart).count();
+
+	const int64_t wallUs = CounterToUs(lastEndQpc - UsToCounter(1000000));
+	result.driftSteps = (static_cast<double>(result.steps) * ts2fix::kGameplayFrameTimeUs - static_cast<double>(wallUs)) /
+		ts2fix::kGameplayFrameTimeUs;
+	result.p50ErrorUs = Percentile(errorsUs, 0.50);
+	result.p99ErrorUs = Percentile(errorsUs, 0.99);
+	result.maxErrorUs = errorsUs.empty() ? 0.0 : *std::max_element(errorsUs.begin(), errorsUs.end());
+	result.blockedUsPerFrame = result.pacedFrames != 0 ? static_cast<double>(blockedUs) / result.pacedFrames : 0.0;
+	result.nsPerFrame = wallNs / std::max<uint32_t>(result.frames, 1);
+	result.finalMode = state.mode;
+	result.transitions = environment.transitions;
+
+	int64_t intervalSumUs = 0;
+	for (const int64_t interval : intervalsUs)
+		intervalSumUs += interval;
+	result.meanIntervalUs = intervalsUs.empty() ? 0.0 : static_cast<double>(intervalSumUs) / intervalsUs.size();
+
+	// intervalsUs[i] ends at frame i + 1. Look at the ten frames after the longest one for back-to-back catch-up.
+	const int64_t burstThresholdUs = tuning.targetFrameTimeUs / 2;
+	for (uint32_t frame = longestFrame + 1; frame < longestFrame + 11 && frame - 1 < intervalsUs.size(); ++frame)
+	{
+		if (intervalsUs[frame - 1] < burstThresholdUs)
+			result.burstFramesAfterStall += 1;
+	}
+
+	return result;
+}
+
+std::vector<Scenario> BuildScenarios()
+{
+	std::vector<Scenario> scenarios;
+
+	Scenario steady = {};
+	steady.name = "steady144";
+	steady.description = "144 Hz, 3 ms of game work every frame";
+	steady.refreshHz = 144;
+	steady.zeroSpeedSafetyReady = true;
+	steady.frameCostUs = [](uint32_t) { return 3000; };
+	steady.expectedFinalMode = FrameTimerMode::CustomZeroStep;
+	steady.expectedTransitions = 1;
+	steady.maxDriftSteps = 2.0;
+	steady.maxP99ErrorUs = 1500.0;
+	steady.fixedSteps = -1;
+	steady.maxRepeatedRefreshes = -1;
+	scenarios.push_back(steady);
+
+	Scenario hitches = steady;
+	hitches.name = "hitch144";
+	hitches.description = "144 Hz with a 45 ms hitch every 2 seconds";
+	hitches.frameCostUs = [](uint32_t frame) { return frame % 288 == 287 ? 45000 : 3000; };
+	hitches.expectResync = false;
+	scenarios.push_back(hitches);
+
+	Scenario load = steady;
+	load.name = "load144";
+	load.description = "144 Hz with a 3 second load after 5 seconds";
+	load.frameCostUs = [](uint32_t frame) { return frame == 720 ? 3000000 : 3000; };
+	// The accumulator caps at 16 steps, so most of the load is dropped from the simulation by design.
+	load.maxDriftSteps = 200.0;
+	load.expectResync = true;
+	scenarios.push_back(load);
+
+	Scenario safe = steady;
+	safe.name = "safe60";
+	safe.description = "144 Hz panel without the zero-step safety patches";
+	safe.zeroSpeedSafetyReady = false;
+	safe.expectedFinalMode = FrameTimerMode::CustomSafe60;
+	safe.fixedSteps = 1;
+	scenarios.push_back(safe);
+
+	Scenario demo = steady;
+	demo.name = "demo60";
+	demo.description = "attract-mode demo at 60 Hz, paced at 30 Hz";
+	demo.refreshHz = 60;
+	demo.demoMode = true;
+	demo.expectedFinalMode = FrameTimerMode::CustomSafe60;
+	demo.fixedSteps = 2;
+	scenarios.push_back(demo);
+
+	Scenario frozen = steady;
+	frozen.name = "frozen144";
+	frozen.description = "144 Hz with QPC frozen for 200 frames, which must trip the anomaly fallback";
+	frozen.frozenBegin = 1000;
+	frozen.frozenEnd = 1200;
+	frozen.expectedFinalMode = FrameTimerMode::CustomSafe60;
+	frozen.expectedTransitions = 2;
+	// Frames run back to back while the counter is frozen, so the wall clock gets ahead of the simulation.
+	frozen.maxDriftSteps = 50.0;
+	scenarios.push_back(frozen);
+
+	// background_fps at its lowest: each 50 ms frame has to carry three simulation steps.
+	Scenario background = steady;
+	background.name = "background144";
+	background.description = "144 Hz with 8 seconds unfocused at background_fps = 20";
+	background.backgroundBegin = 720;
+	background.backgroundEnd = 720 + 160;
+	background.backgroundFps = 20;
+	scenarios.push_back(background);
+
+	// Panels rarely run at exactly their nominal rate. Free-running 144 Hz deadlines slide against a 144.3 Hz display
+	// and repeat a refresh every few seconds; locked to the measured vblank they shouldn't.
+	Scenario drift = steady;
+	drift.name = "drift144";
+	drift.description = "144 Hz deadlines on a 144.3 Hz display, free-running";
+	drift.displayHz = 144.3;
+	scenarios.push_back(drift);
+
+	Scenario vblank = drift;
+	vblank.name = "vblank144";
+	vblank.description = "144 Hz deadlines on a 144.3 Hz display, locked to its vblank";
+	vblank.vblankLock = true;
+	vblank.maxRepeatedRefreshes = 0;
+	scenarios.push_back(vblank);
+
+	return scenarios;
+}
+
+bool CheckScenario(const Scenario& scenario, const ScenarioResult& result)
+{
+	bool ok = true;
+	auto expect = [&](bool condition, const char* what) {
+		if (!condition)
+		{
+			std::printf("    FAIL: %s\n", what);
+			ok = false;
+		}
+	};
+
+	expect(result.finalMode == scenario.expectedFinalMode, "final mode");
+	expect(result.transitions.size() == scenario.expectedTransitions, "mode transition count");
+	expect(std::fabs(result.driftSteps) <= scenario.maxDriftSteps, "simulation drift");
+	expect(result.p99ErrorUs <= scenario.maxP99ErrorUs, "p99 pacing error");
+	expect(result.fixedStepsHeld, "steps per frame");
+	if (scenario.expectResync)
+		expect(result.burstFramesAfterStall == 0, "deadline resync after the longest frame");
+	if (scenario.maxRepeatedRefreshes >= 0)
+		expect(result.repeatedRefreshes + result.droppedFrames <= static_cast<uint32_t>(scenario.maxRepeatedRefreshes), "frames on every refresh");
+	return ok;
+}
+
+void PrintUsage()
+{
+	std::fprintf(stderr,
+		"usage: FrameTimerReplay [options]\n"
+		"options:\n"
+		"  --scenario NAME  run only NAME (default: all)\n"
+		"  --seconds N      virtual seconds per scenario (default 20)\n"
+		"  --seed N         wake-up jitter seed (default 1)\n"
+		"  --list           list the scenarios\n");
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const char* only = nullptr;
+	double seconds = 20.0;
+	uint32_t seed = 1;
+	bool list = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(arg, "--scenario") == 0 && hasValue)
+			only = argv[++i];
+		else if (std::strcmp(arg, "--seconds") == 0 && hasValue)
+			seconds = std::max(1.0, std::strtod(argv[++i], nullptr));
+		else if (std::strcmp(arg, "--seed") == 0 && hasValue)
+			seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(arg, "--list") == 0)
+			list = true;
+		else
+		{
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	const std::vector<Scenario> scenarios = BuildScenarios();
+	bool allPassed = true;
+	bool ranAny = false;
+	for (const Scenario& scenario : scenarios)
+	{
+		if (list)
+		{
+			std::printf("%-10s %s\n", scenario.name, scenario.description);
+			continue;
+		}
+		if (only != nullptr && std::strcmp(only, scenario.name) != 0)
+			continue;
+		ranAny = true;
+
+		const ScenarioResult result = RunScenario(scenario, seconds, seed);
+		std::printf("%s: %s\n", scenario.name, scenario.description);
+		std::printf("  frames %u (paced %u), steps %llu (%u zero-step), drift %+.2f steps, mean interval %.1f us\n",
+			result.frames, result.pacedFrames, static_cast<unsigned long long>(result.steps), result.zeroStepFrames,
+			result.driftSteps, result.meanIntervalUs);
+		std::printf("  pacing error p50 %.0f us, p99 %.0f us, max %.0f us; blocked %.0f us/frame; %.0f ns/frame in the state machine\n",
+			result.p50ErrorUs, result.p99ErrorUs, result.maxErrorUs, result.blockedUsPerFrame, result.nsPerFrame);
+		if (scenario.displayHz > 0.0)
+			std::printf("  display %.1f Hz: %u repeated refreshes, %u dropped frames\n", scenario.displayHz, result.repeatedRefreshes, result.droppedFrames);
+		for (const ModeTransition& transition : result.transitions)
+		{
+			std::printf("  frame %u: %s -> %s (%s)\n", transition.frame, ts2fix::GetFrameTimerModeName(transition.from),
+				ts2fix::GetFrameTimerModeName(transition.to), transition.reason);
+		}
+
+		const bool passed = CheckScenario(scenario, result);
+		std::printf("  %s\n", passed ? "ok" : "<-- check");
+		allPassed = allPassed && passed;
+	}
+
+	if (!list && !ranAny)
+	{
+		std::fprintf(stderr, "error: no scenario named %s\n", only);
+		return 2;
+	}
+	return allPassed ? 0 : 1;
+}
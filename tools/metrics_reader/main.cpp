@@ -0,0 +1,199 @@
+// Live metrics reader: attaches to the shared-memory block a running toy2.exe publishes (see [Framerate] live_metrics)
+// and prints frame-timer modes, the refresh target, recent frame times and hook counters. Reading never touches the
+// game's timing, so it can stay attached on machines under load.
+
+#include <windows.h>
+#include <TlHelp32.h>
+
+#include "ts2fix/live_metrics_layout.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+constexpr int kMaxSnapshotRetries = 64;
+
+const char* const kCallsiteNames[ts2fix::kLiveMetricsCallsites] = { "Unknown", "Gameplay", "Frontend", "Menu" };
+const char* const kModeNames[] = { "LegacyPassthrough", "CustomSafe60", "CustomZeroStep" };
+
+struct Options
+{
+	DWORD processId = 0;
+	DWORD intervalMs = 1000;
+	bool once = false;
+};
+
+void PrintUsage()
+{
+	std::fprintf(stderr,
+		"usage: MetricsReader [options] [pid]\n"
+		"  pid            game process to attach to (default: the first toy2.exe found)\n"
+		"options:\n"
+		"  --interval MS  refresh interval (default 1000)\n"
+		"  --once         print one snapshot and exit\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		if (std::strcmp(arg, "--once") == 0)
+			options.once = true;
+		else if (std::strcmp(arg, "--interval") == 0 && i + 1 < argc)
+			options.intervalMs = std::max(50ul, std::strtoul(argv[++i], nullptr, 10));
+		else if (arg[0] != '-' && options.processId == 0)
+			options.processId = std::strtoul(arg, nullptr, 10);
+		else
+			return false;
+	}
+	return true;
+}
+
+DWORD FindGameProcess()
+{
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+	if (snapshot == INVALID_HANDLE_VALUE)
+		return 0;
+
+	DWORD processId = 0;
+	PROCESSENTRY32 entry = {};
+	entry.dwSize = sizeof(entry);
+	for (BOOL more = Process32First(snapshot, &entry); more; more = Process32Next(snapshot, &entry))
+	{
+		if (_stricmp(entry.szExeFile, "toy2.exe") == 0)
+		{
+			processId = entry.th32ProcessID;
+			break;
+		}
+	}
+
+	CloseHandle(snapshot);
+	return processId;
+}
+
+// Copies the block out between two even, equal sequence values; see LiveMetricsBlock.
+bool TakeSnapshot(const ts2fix::LiveMetricsBlock* block, ts2fix::LiveMetricsBlock& snapshot)
+{
+	for (int attempt = 0; attempt < kMaxSnapshotRetries; ++attempt)
+	{
+		const uint32_t before = block->sequence;
+		MemoryBarrier();
+		if ((before & 1) == 0)
+		{
+			std::memcpy(&snapshot, block, sizeof(snapshot));
+			MemoryBarrier();
+			if (block->sequence == before)
+				return true;
+		}
+		YieldProcessor();
+	}
+	return false;
+}
+
+const char* GetModeName(uint32_t mode)
+{
+	return mode < std::size(kModeNames) ? kModeNames[mode] : "?";
+}
+
+void PrintSnapshot(const ts2fix::LiveMetricsBlock& block)
+{
+	const uint32_t history = static_cast<uint32_t>(std::min<uint64_t>(block.frameCount, ts2fix::kLiveMetricsFrameHistory));
+
+	uint32_t sorted[ts2fix::kLiveMetricsFrameHistory] = {};
+	uint64_t sumUs = 0;
+	for (uint32_t i = 0; i < history; ++i)
+	{
+		sorted[i] = block.frameTimesUs[(block.frameCount - 1 - i) % ts2fix::kLiveMetricsFrameHistory];
+		sumUs += sorted[i];
+	}
+	std::sort(sorted, sorted + history);
+
+	std::printf("pid %u  publishers:%s%s  target %u Hz (%d us)  frames %llu\n", block.processId,
+		(block.publishers & ts2fix::kLiveMetricsPublisherAsi) != 0 ? " asi" : "",
+		(block.publishers & ts2fix::kLiveMetricsPublisherWrapper) != 0 ? " wrapper" : "",
+		block.targetRefreshHz, block.targetFrameTimeUs, static_cast<unsigned long long>(block.frameCount));
+
+	if (history != 0)
+	{
+		std::printf("last %u frames: mean %llu us  p50 %u us  p99 %u us  max %u us\n", history,
+			static_cast<unsigned long long>(sumUs / history), sorted[(history - 1) / 2], sorted[((history - 1) * 99) / 100],
+			sorted[history - 1]);
+	}
+
+	std::printf("%-9s %-18s %9s %12s %12s %10s\n", "callsite", "mode", "switches", "hook calls", "paced", "last us");
+	for (uint32_t i = 0; i < ts2fix::kLiveMetricsCallsites; ++i)
+	{
+		const ts2fix::LiveCallsiteMetrics& metrics = block.callsites[i];
+		std::printf("%-9s %-18s %9u %12llu %12llu %10u\n", kCallsiteNames[i], GetModeName(metrics.mode), metrics.modeSwitches,
+			static_cast<unsigned long long>(metrics.hookCalls), static_cast<unsigned long long>(metrics.pacedFrames), metrics.lastFrameUs);
+	}
+	std::fflush(stdout);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	if (options.processId == 0)
+		options.processId = FindGameProcess();
+	if (options.processId == 0)
+	{
+		std::fprintf(stderr, "error: toy2.exe is not running\n");
+		return 1;
+	}
+
+	char name[64] = {};
+	ts2fix::FormatLiveMetricsName(name, sizeof(name), options.processId);
+	HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+	if (mapping == nullptr)
+	{
+		std::fprintf(stderr, "error: no metrics block for pid %lu (is live_metrics enabled?)\n", options.processId);
+		return 1;
+	}
+
+	const auto* block = static_cast<const ts2fix::LiveMetricsBlock*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, sizeof(ts2fix::LiveMetricsBlock)));
+	if (block == nullptr || block->version != ts2fix::kLiveMetricsVersion || block->size != sizeof(ts2fix::LiveMetricsBlock))
+	{
+		std::fprintf(stderr, "error: metrics block for pid %lu has an unknown layout\n", options.processId);
+		return 1;
+	}
+
+	for (;;)
+	{
+		ts2fix::LiveMetricsBlock snapshot;
+		if (TakeSnapshot(block, snapshot))
+			PrintSnapshot(snapshot);
+		else
+			std::printf("(block busy, retrying)\n");
+
+		if (options.once)
+			break;
+
+		// The mapping outlives the game as long as we hold it open, so watch the process instead.
+		HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, options.processId);
+		const bool exited = process == nullptr || WaitForSingleObject(process, options.intervalMs) == WAIT_OBJECT_0;
+		if (process != nullptr)
+			CloseHandle(process);
+		if (exited)
+		{
+			std::printf("pid %lu exited\n", options.processId);
+			break;
+		}
+		std::printf("\n");
+	}
+
+	UnmapViewOfFile(block);
+	CloseHandle(mapping);
+	return 0;
+}
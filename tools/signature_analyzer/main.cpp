@@ -0,0 +1,283 @@
+// Offline signature analyzer: maps toy2.exe (or a synthetic PE32 image) on the host and runs every signature the ASI
+// and the ddraw wrapper look up through the same hook::pattern scanner, reporting matches, RVAs and scan times.
+
+#include <windows.h>
+
+#include "Hooking.Patterns.h"
+#include "pe_image.h"
+#include "ts2fix/signatures.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct NamedSignature
+{
+	const char* name;
+	hook::pattern_view pattern;
+};
+
+#define TS2FIX_SIGNATURE(name) { #name, ts2fix::signatures::name }
+
+const NamedSignature kSignatures[] = {
+	TS2FIX_SIGNATURE(kInitReady),
+	TS2FIX_SIGNATURE(kSpeedMultiplier),
+	TS2FIX_SIGNATURE(kIsDemoMode),
+	TS2FIX_SIGNATURE(kMenuFrameTimerCall),
+	TS2FIX_SIGNATURE(kGameplayFrameTimerCall),
+	TS2FIX_SIGNATURE(kFrontendFrameTimerCall),
+	TS2FIX_SIGNATURE(kSafetyMultiply),
+	TS2FIX_SIGNATURE(kSafetyDivide),
+	TS2FIX_SIGNATURE(kSafetyMenuDivide),
+	TS2FIX_SIGNATURE(kSafetyRenderDelta),
+	TS2FIX_SIGNATURE(kSafetyRenderMotionA),
+	TS2FIX_SIGNATURE(kSafetyRenderMotionB),
+	TS2FIX_SIGNATURE(kSafetyRenderMotionC),
+	TS2FIX_SIGNATURE(kSafetyRenderMotionD),
+	TS2FIX_SIGNATURE(kSafetyRenderMotionE),
+	TS2FIX_SIGNATURE(kSafetyRenderMotionF),
+	TS2FIX_SIGNATURE(kSafetyRenderMotionG),
+	TS2FIX_SIGNATURE(kAllow32Bit),
+	TS2FIX_SIGNATURE(kIgnoreVRAM),
+	TS2FIX_SIGNATURE(kSkipSplash),
+	TS2FIX_SIGNATURE(kRenderDistanceTable),
+	TS2FIX_SIGNATURE(kWidescreenCall),
+	TS2FIX_SIGNATURE(kWidescreenResolution),
+	TS2FIX_SIGNATURE(kWidescreen3DScale),
+	TS2FIX_SIGNATURE(kProjectionDepthRange),
+	TS2FIX_SIGNATURE(kDepthStateFunction),
+};
+
+#undef TS2FIX_SIGNATURE
+
+static_assert(std::size(kSignatures) == std::size(ts2fix::signatures::kInstallSignatures) + 1,
+	"every signature in signatures.h needs a row here");
+
+struct Options
+{
+	const char* imagePath = nullptr;
+	bool synthetic = false;
+	unsigned threads = 1;
+	hook::scan_isa isa = hook::scan_isa::automatic;
+	unsigned repeat = 5;
+	uint32_t codeSizeKb = 2048;
+	uint32_t seed = 1;
+	bool buildRow = false;
+};
+
+struct SignatureResult
+{
+	std::size_t matches = 0;
+	uintptr_t firstRva = 0;
+	double bestMs = 0.0;
+};
+
+tools::LoadedImage g_image;
+
+void PrintUsage()
+{
+	std::fprintf(stderr,
+		"usage: SignatureAnalyzer [options] <toy2.exe>\n"
+		"       SignatureAnalyzer [options] --synthetic\n"
+		"options:\n"
+		"  --threads N     scan threads, 0 = one per CPU thread (default 1)\n"
+		"  --isa NAME      auto, scalar, sse2 or avx2 (default auto)\n"
+		"  --repeat N      time every scan N times and keep the fastest (default 5)\n"
+		"  --code-size KB  synthetic code section size (default 2048)\n"
+		"  --seed N        synthetic filler seed (default 1)\n"
+		"  --build-row     print the executable's row for the known-build table in source/build_database.cpp\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "--synthetic") == 0)
+			options.synthetic = true;
+		else if (std::strcmp(arg, "--build-row") == 0)
+			options.buildRow = true;
+		else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+			options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(arg, "--repeat") == 0 && hasValue)
+			options.repeat = std::max(1u, static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10)));
+		else if (std::strcmp(arg, "--code-size") == 0 && hasValue)
+			options.codeSizeKb = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(arg, "--seed") == 0 && hasValue)
+			options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(arg, "--isa") == 0 && hasValue)
+		{
+			const char* name = argv[++i];
+			if (std::strcmp(name, "auto") == 0)
+				options.isa = hook::scan_isa::automatic;
+			else if (std::strcmp(name, "scalar") == 0)
+				options.isa = hook::scan_isa::scalar;
+			else if (std::strcmp(name, "sse2") == 0)
+				options.isa = hook::scan_isa::sse2;
+			else if (std::strcmp(name, "avx2") == 0)
+				options.isa = hook::scan_isa::avx2;
+			else
+				return false;
+		}
+		else if (arg[0] != '-' && options.imagePath == nullptr)
+			options.imagePath = arg;
+		else
+			return false;
+	}
+
+	return options.synthetic != (options.imagePath != nullptr) && !(options.synthetic && options.buildRow);
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+uintptr_t ToRva(const void* address)
+{
+	return reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(g_image.base);
+}
+
+// Full scan for every match, the way pattern::size() runs it in the game, with hints cleared before each run.
+SignatureResult ScanSignature(const hook::pattern_view& signature, unsigned repeat)
+{
+	SignatureResult result;
+	for (unsigned run = 0; run < repeat; ++run)
+	{
+		hook::pattern::clear_hints();
+
+		const auto start = std::chrono::steady_clock::now();
+		hook::pattern pattern(signature);
+		const std::size_t matches = pattern.size();
+		const double elapsedMs = ElapsedMs(start);
+
+		result.matches = matches;
+		result.firstRva = matches != 0 ? ToRva(pattern.get(0).get<void>()) : 0;
+		result.bestMs = run == 0 ? elapsedMs : std::min(result.bestMs, elapsedMs);
+	}
+	return result;
+}
+
+// Only offsets that resolved to exactly one match go in; the game verifies and scans for the rest anyway.
+void PrintBuildRow(const char* imagePath, const std::vector<SignatureResult>& results)
+{
+	const char* fileName = std::strrchr(imagePath, '/');
+	fileName = fileName != nullptr ? fileName + 1 : imagePath;
+
+	std::printf("\n\t{ 0x%016llx, \"%s\", {\n", static_cast<unsigned long long>(g_image.fingerprint), fileName);
+	for (std::size_t i = 0; i < results.size(); ++i)
+	{
+		// Init waits for kInitReady before any offset is applied, so it has no place in the table.
+		if (kSignatures[i].pattern.hash == ts2fix::signatures::kInitReady.hash || results[i].matches != 1)
+			continue;
+		std::printf("\t\t{ signatures::%s.hash, 0x%08llx },\n", kSignatures[i].name, static_cast<unsigned long long>(results[i].firstRva));
+	}
+	std::printf("\t} },\n");
+}
+} // namespace
+
+namespace host
+{
+void* GetMainModule()
+{
+	return g_image.base;
+}
+} // namespace host
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	std::vector<hook::pattern_view> patterns;
+	for (const NamedSignature& signature : kSignatures)
+		patterns.push_back(signature.pattern);
+
+	std::string error;
+	std::vector<tools::PlantedSignature> planted;
+	const bool loaded = options.synthetic
+		? tools::BuildSyntheticImage(patterns, options.codeSizeKb * 1024, options.seed, g_image, planted, error)
+		: tools::MapPeFile(options.imagePath, g_image, error);
+	if (!loaded)
+	{
+		std::fprintf(stderr, "error: %s\n", error.c_str());
+		return 2;
+	}
+
+	hook::set_scan_isa(options.isa);
+	hook::set_scan_threads(options.threads);
+
+	std::printf("image: %s, %u section(s), code 0x%08x-0x%08x (%.2f MiB), %u scan thread(s)\n",
+		options.synthetic ? "synthetic" : options.imagePath, g_image.sectionCount, g_image.codeBegin, g_image.codeEnd,
+		(g_image.codeEnd - g_image.codeBegin) / (1024.0 * 1024.0), hook::get_scan_threads());
+	std::printf("%-26s %8s %12s %10s%s\n", "signature", "matches", "first rva", "scan ms", options.synthetic ? "  planted" : "");
+
+	bool allResolved = true;
+	double serialTotalMs = 0.0;
+	std::vector<SignatureResult> results;
+	for (std::size_t i = 0; i < patterns.size(); ++i)
+	{
+		const SignatureResult result = ScanSignature(patterns[i], options.repeat);
+		serialTotalMs += result.bestMs;
+		results.push_back(result);
+
+		// The installers expect exactly one hit; anything else means the signature needs attention on this build.
+		bool resolved = result.matches == 1;
+		std::printf("%-26s %8zu   0x%08llx %10.3f", kSignatures[i].name, result.matches,
+			static_cast<unsigned long long>(result.firstRva), result.bestMs);
+		if (options.synthetic)
+		{
+			resolved = result.matches == planted[i].expectedMatches && result.firstRva == planted[i].rva;
+			std::printf("  0x%08x", planted[i].rva);
+		}
+		std::printf("%s\n", resolved ? "" : "  <-- check");
+		allResolved = allResolved && resolved;
+	}
+
+	// The single-pass batch PrefetchSignatures runs, checked against the per-pattern results above.
+	double batchMs = 0.0;
+	std::size_t batchMatched = 0;
+	std::size_t disagreements = 0;
+	for (unsigned run = 0; run < options.repeat; ++run)
+	{
+		hook::pattern::clear_hints();
+
+		const auto start = std::chrono::steady_clock::now();
+		hook::pattern_batch batch;
+		for (const hook::pattern_view& pattern : patterns)
+			batch.add(pattern);
+		batchMatched = batch.resolve();
+		const double elapsedMs = ElapsedMs(start);
+		batchMs = run == 0 ? elapsedMs : std::min(batchMs, elapsedMs);
+	}
+
+	for (std::size_t i = 0; i < patterns.size(); ++i)
+	{
+		hook::pattern pattern(patterns[i]);
+		const uintptr_t rva = pattern.count_hint(1).empty() ? 0 : ToRva(pattern.get(0).get<void>());
+		if (rva != results[i].firstRva)
+			++disagreements;
+	}
+
+	std::printf("batch: %zu/%zu matched in %.3f ms (per-pattern total %.3f ms), %zu disagreement(s)\n",
+		batchMatched, patterns.size(), batchMs, serialTotalMs, disagreements);
+
+	if (options.buildRow)
+		PrintBuildRow(options.imagePath, results);
+
+	tools::UnmapImage(g_image);
+	return allResolved && disagreements == 0 ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#include "pe_image.h"
+
+#include <windows.h>
+
+#include "ts2fix/image_fingerprint.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr uint32_t kPageSize = 0x1000;
+constexpr uint32_t kSyntheticImageBase = 0x400000;
+constexpr uint32_t kSyntheticCodeRva = 0x1000;
+
+uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint8_t* AllocateImage(std::size_t size)
+{
+	void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return memory == MAP_FAILED ? nullptr : static_cast<uint8_t*>(memory);
+}
+
+void RecordCodeRange(tools::LoadedImage& image)
+{
+	auto* ntHeaders = reinterpret_cast<IMAGE_NT_HEADERS*>(image.base + reinterpret_cast<IMAGE_DOS_HEADER*>(image.base)->e_lfanew);
+	IMAGE_SECTION_HEADER* section = IMAGE_FIRST_SECTION(ntHeaders);
+
+	image.sectionCount = ntHeaders->FileHeader.NumberOfSections;
+	image.codeBegin = 0;
+	image.codeEnd = 0;
+	for (uint16_t i = 0; i < image.sectionCount; ++i, ++section)
+	{
+		if ((section->Characteristics & IMAGE_SCN_MEM_EXECUTE) == 0)
+			continue;
+
+		const uint32_t size = std::max(section->SizeOfRawData, section->Misc.VirtualSize);
+		if (image.codeEnd == 0)
+			image.codeBegin = section->VirtualAddress;
+		image.codeBegin = std::min(image.codeBegin, section->VirtualAddress);
+		image.codeEnd = std::max(image.codeEnd, section->VirtualAddress + size);
+	}
+}
+} // namespace
+
+namespace tools
+{
+bool MapPeFile(const char* path, LoadedImage& image, std::string& error)
+{
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		error = std::string("cannot open ") + path;
+		return false;
+	}
+
+	struct stat info = {};
+	if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(IMAGE_DOS_HEADER)))
+	{
+		close(fd);
+		error = "file is too small to be a PE image";
+		return false;
+	}
+
+	const std::size_t fileSize = static_cast<std::size_t>(info.st_size);
+	void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED)
+	{
+		error = "cannot map the file";
+		return false;
+	}
+
+	const uint8_t* file = static_cast<const uint8_t*>(view);
+	bool ok = false;
+	do
+	{
+		const auto* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(file);
+		if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE || dosHeader->e_lfanew < 0 ||
+			static_cast<std::size_t>(dosHeader->e_lfanew) + sizeof(IMAGE_NT_HEADERS) > fileSize)
+		{
+			error = "missing DOS/NT headers";
+			break;
+		}
+
+		const auto* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(file + dosHeader->e_lfanew);
+		if (ntHeaders->Signature != IMAGE_NT_SIGNATURE || ntHeaders->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR32_MAGIC)
+		{
+			error = "not a PE32 image";
+			break;
+		}
+
+		const auto* sections = IMAGE_FIRST_SECTION(ntHeaders);
+		const uint16_t sectionCount = ntHeaders->FileHeader.NumberOfSections;
+		if (reinterpret_cast<const uint8_t*>(sections + sectionCount) > file + fileSize)
+		{
+			error = "truncated section table";
+			break;
+		}
+
+		// executable_meta trusts SizeOfRawData, which may run past SizeOfImage; cover both.
+		uint32_t mappedSize = ntHeaders->OptionalHeader.SizeOfImage;
+		for (uint16_t i = 0; i < sectionCount; ++i)
+			mappedSize = std::max(mappedSize, sections[i].VirtualAddress + std::max(sections[i].SizeOfRawData, sections[i].Misc.VirtualSize));
+		mappedSize = AlignUp(mappedSize, kPageSize);
+
+		image.base = AllocateImage(mappedSize);
+		if (image.base == nullptr)
+		{
+			error = "cannot allocate the image";
+			break;
+		}
+		image.size = mappedSize;
+
+		const std::size_t headerSize = std::min<std::size_t>(ntHeaders->OptionalHeader.SizeOfHeaders, std::min<std::size_t>(fileSize, mappedSize));
+		std::memcpy(image.base, file, headerSize);
+
+		for (uint16_t i = 0; i < sectionCount; ++i)
+		{
+			const IMAGE_SECTION_HEADER& section = sections[i];
+			if (section.PointerToRawData >= fileSize)
+				continue;
+
+			const std::size_t rawSize = std::min<std::size_t>(section.SizeOfRawData, fileSize - section.PointerToRawData);
+			std::memcpy(image.base + section.VirtualAddress, file + section.PointerToRawData, rawSize);
+		}
+
+		RecordCodeRange(image);
+		image.fingerprint = ts2fix::HashExecutableFile(file, fileSize);
+		ok = true;
+	} while (false);
+
+	munmap(view, fileSize);
+	return ok;
+}
+
+bool BuildSyntheticImage(const std::vector<hook::pattern_view>& signatures, uint32_t codeSize, uint32_t seed, LoadedImage& image,
+	std::vector<PlantedSignature>& planted, std::string& error)
+{
+	codeSize = AlignUp(codeSize, kPageSize);
+	const uint32_t imageSize = kSyntheticCodeRva + codeSize;
+
+	// Every signature gets its own slot with room to spare, so plants never overlap.
+	const uint32_t slotSize = signatures.empty() ? codeSize : (codeSize / static_cast<uint32_t>(signatures.size() + 1)) & ~15u;
+	if (slotSize < 256)
+	{
+		error = "synthetic code section is too small for the signature list";
+		return false;
+	}
+
+	image.base = AllocateImage(imageSize);
+	if (image.base == nullptr)
+	{
+		error = "cannot allocate the image";
+		return false;
+	}
+	image.size = imageSize;
+
+	auto* dosHeader = reinterpret_cast<IMAGE_DOS_HEADER*>(image.base);
+	dosHeader->e_magic = IMAGE_DOS_SIGNATURE;
+	dosHeader->e_lfanew = 0x80;
+
+	auto* ntHeaders = reinterpret_cast<IMAGE_NT_HEADERS*>(image.base + dosHeader->e_lfanew);
+	ntHeaders->Signature = IMAGE_NT_SIGNATURE;
+	ntHeaders->FileHeader.Machine = IMAGE_FILE_MACHINE_I386;
+	ntHeaders->FileHeader.NumberOfSections = 1;
+	ntHeaders->FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+	ntHeaders->OptionalHeader.Magic = IMAGE_NT_OPTIONAL_HDR32_MAGIC;
+	ntHeaders->OptionalHeader.ImageBase = kSyntheticImageBase;
+	ntHeaders->OptionalHeader.SectionAlignment = kPageSize;
+	ntHeaders->OptionalHeader.FileAlignment = 0x200;
+	ntHeaders->OptionalHeader.SizeOfImage = imageSize;
+	ntHeaders->OptionalHeader.SizeOfHeaders = 0x400;
+	ntHeaders->OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+
+	IMAGE_SECTION_HEADER* section = IMAGE_FIRST_SECTION(ntHeaders);
+	std::memcpy(section->Name, ".text", 5);
+	section->Misc.VirtualSize = codeSize;
+	section->VirtualAddress = kSyntheticCodeRva;
+	section->SizeOfRawData = codeSize;
+	section->PointerToRawData = 0x400;
+	section->Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ;
+
+	// Lean the filler towards common x86 opcode and ModRM bytes so anchors see a realistic byte mix.
+	static const uint8_t kCommonBytes[] = { 0x00, 0x8B, 0x89, 0xFF, 0xE8, 0x83, 0xC4, 0x24, 0x04, 0x08, 0x50, 0x56, 0x57,
+		0x85, 0xC0, 0x74, 0x75, 0x0F, 0x44, 0x45, 0x6A, 0x01, 0x33, 0xC3, 0xCC, 0x90 };
+	std::mt19937 random(seed);
+	uint8_t* code = image.base + kSyntheticCodeRva;
+	for (uint32_t i = 0; i < codeSize; ++i)
+	{
+		const uint32_t roll = random();
+		code[i] = (roll & 1) != 0 ? kCommonBytes[(roll >> 1) % sizeof(kCommonBytes)] : static_cast<uint8_t>(roll >> 8);
+	}
+
+	planted.assign(signatures.size(), {});
+	for (std::size_t i = 0; i < signatures.size(); ++i)
+	{
+		const hook::pattern_view& signature = signatures[i];
+		const uint32_t rva = kSyntheticCodeRva + slotSize * static_cast<uint32_t>(i + 1) - static_cast<uint32_t>(signature.size) / 2;
+		for (std::size_t b = 0; b < signature.size; ++b)
+			image.base[rva + b] = signature.mask[b] != 0 ? signature.bytes[b] : static_cast<uint8_t>(random());
+		planted[i].rva = rva;
+	}
+
+	for (std::size_t i = 0; i < signatures.size(); ++i)
+	{
+		const hook::pattern_view& signature = signatures[i];
+		for (const PlantedSignature& plant : planted)
+		{
+			bool matches = true;
+			for (std::size_t b = 0; b < signature.size && matches; ++b)
+				matches = (image.base[plant.rva + b] & signature.mask[b]) == (signature.bytes[b] & signature.mask[b]);
+			if (matches)
+				++planted[i].expectedMatches;
+		}
+	}
+
+	RecordCodeRange(image);
+	return true;
+}
+
+void UnmapImage(LoadedImage& image)
+{
+	if (image.base != nullptr)
+		munmap(image.base, image.size);
+	image = {};
+}
+} // namespace tools
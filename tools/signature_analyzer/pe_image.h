@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Hooking.Patterns.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tools
+{
+struct LoadedImage
+{
+	uint8_t* base = nullptr;
+	std::size_t size = 0;
+	uint32_t codeBegin = 0; // RVA range covered by executable sections
+	uint32_t codeEnd = 0;
+	uint16_t sectionCount = 0;
+	uint64_t fingerprint = 0; // ts2fix::HashExecutableFile of the file; 0 for synthetic images
+};
+
+// Maps a PE32 file the way the loader would: headers at the base, every section at its virtual address, zero-filled
+// past its raw data.
+bool MapPeFile(const char* path, LoadedImage& image, std::string& error);
+
+struct PlantedSignature
+{
+	uint32_t rva = 0;
+	uint32_t expectedMatches = 0; // more than one when the signature is a prefix of another one that was planted
+};
+
+// Builds a PE32 image with one code section of instruction-like filler and plants every signature in it, wildcards
+// filled with random bytes.
+bool BuildSyntheticImage(const std::vector<hook::pattern_view>& signatures, uint32_t codeSize, uint32_t seed, LoadedImage& image,
+	std::vector<PlantedSignature>& planted, std::string& error);
+
+void UnmapImage(LoadedImage& image);
+} // namespace tools
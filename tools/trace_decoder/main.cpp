@@ -0,0 +1,373 @@
+// Trace decoder: renders the binary diagnostic trace written with [Framerate] diagnostic_trace (ToyStory2Fix.trace,
+// ddraw.trace) as log-style text or CSV. Portable; builds on the host with the gmake tools.
+
+#include "ts2fix/trace_format.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+	const char* path = nullptr;
+	const char* subsystem = nullptr;
+	bool csv = false;
+};
+
+struct FormatDefinition
+{
+	std::string subsystem;
+	std::string format;
+	std::vector<ts2fix::TraceArgKind> kinds;
+};
+
+struct ArgValue
+{
+	ts2fix::TraceArgKind kind;
+	uint64_t bits;
+	double real;
+	std::string text;
+};
+
+void PrintUsage()
+{
+	std::fprintf(stderr,
+		"usage: TraceDecoder [options] file.trace\n"
+		"options:\n"
+		"  --csv              one row per event: time_ms,thread,subsystem,message\n"
+		"  --subsystem NAME   only events from this subsystem\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		if (std::strcmp(arg, "--csv") == 0)
+			options.csv = true;
+		else if (std::strcmp(arg, "--subsystem") == 0 && i + 1 < argc)
+			options.subsystem = argv[++i];
+		else if (arg[0] != '-' && options.path == nullptr)
+			options.path = arg;
+		else
+			return false;
+	}
+	return options.path != nullptr;
+}
+
+bool ReadFile(const char* path, std::vector<uint8_t>& data)
+{
+	std::FILE* file = std::fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	uint8_t chunk[64 * 1024];
+	std::size_t read = 0;
+	while ((read = std::fread(chunk, 1, sizeof(chunk), file)) != 0)
+		data.insert(data.end(), chunk, chunk + read);
+	std::fclose(file);
+	return true;
+}
+
+// Bounds-checked reads from one record.
+struct RecordReader
+{
+	const uint8_t* data;
+	std::size_t length;
+	std::size_t offset;
+
+	template <typename T>
+	bool Get(T& value)
+	{
+		if (length - offset < sizeof(value))
+			return false;
+		std::memcpy(&value, data + offset, sizeof(value));
+		offset += sizeof(value);
+		return true;
+	}
+
+	bool GetString(std::string& text)
+	{
+		const void* end = std::memchr(data + offset, '\0', length - offset);
+		if (end == nullptr)
+			return false;
+		const std::size_t size = static_cast<const uint8_t*>(end) - (data + offset);
+		text.assign(reinterpret_cast<const char*>(data + offset), size);
+		offset += size + 1;
+		return true;
+	}
+};
+
+bool ReadFormat(RecordReader& reader, std::unordered_map<uint16_t, FormatDefinition>& formats)
+{
+	uint16_t id = 0;
+	uint8_t argCount = 0;
+	if (!reader.Get(id) || !reader.Get(argCount))
+		return false;
+
+	FormatDefinition definition;
+	for (uint8_t i = 0; i < argCount; ++i)
+	{
+		uint8_t kind = 0;
+		if (!reader.Get(kind))
+			return false;
+		definition.kinds.push_back(static_cast<ts2fix::TraceArgKind>(kind));
+	}
+	if (!reader.GetString(definition.subsystem) || !reader.GetString(definition.format))
+		return false;
+
+	formats[id] = std::move(definition);
+	return true;
+}
+
+bool ReadArgs(RecordReader& reader, const FormatDefinition& definition, std::vector<ArgValue>& args)
+{
+	args.clear();
+	for (ts2fix::TraceArgKind kind : definition.kinds)
+	{
+		ArgValue value = { kind, 0, 0.0, {} };
+		switch (kind)
+		{
+		case ts2fix::TraceArgKind::Int32:
+		{
+			uint32_t bits = 0;
+			if (!reader.Get(bits))
+				return false;
+			value.bits = bits;
+			break;
+		}
+		case ts2fix::TraceArgKind::Int64:
+		case ts2fix::TraceArgKind::Pointer:
+			if (!reader.Get(value.bits))
+				return false;
+			break;
+		case ts2fix::TraceArgKind::Double:
+			if (!reader.Get(value.real))
+				return false;
+			break;
+		case ts2fix::TraceArgKind::String:
+		{
+			uint8_t length = 0;
+			if (!reader.Get(length) || reader.length - reader.offset < length)
+				return false;
+			value.text.assign(reinterpret_cast<const char*>(reader.data + reader.offset), length);
+			reader.offset += length;
+			break;
+		}
+		default:
+			return false;
+		}
+		args.push_back(std::move(value));
+	}
+	return true;
+}
+
+// Rebuilds one conversion for the host's printf: '*' filled in from the arguments, the recording compiler's length
+// modifier swapped for the one that matches how the argument was stored.
+void RenderConversion(const ts2fix::TraceConversion& conversion, const std::vector<ArgValue>& args, std::size_t& next,
+	uint32_t pointerSize, std::string& out)
+{
+	if (conversion.conversion == '%')
+	{
+		out += '%';
+		return;
+	}
+
+	std::string spec = "%";
+	for (std::size_t i = 1; i + 1 < conversion.specLength; ++i)
+	{
+		const char c = conversion.spec[i];
+		if (c == '*')
+			spec += std::to_string(next < args.size() ? static_cast<int32_t>(args[next++].bits) : 0);
+		else if (std::strchr("-+ #0123456789.", c) != nullptr)
+			spec += c;
+		else
+			break; // length modifier
+	}
+
+	if (next >= args.size())
+	{
+		out += "<missing>";
+		return;
+	}
+	const ArgValue& value = args[next++];
+
+	char buffer[512];
+	switch (value.kind)
+	{
+	case ts2fix::TraceArgKind::Int32:
+		spec += conversion.conversion;
+		if (conversion.conversion == 'd' || conversion.conversion == 'i')
+			std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<int32_t>(value.bits));
+		else
+			std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<uint32_t>(value.bits));
+		break;
+	case ts2fix::TraceArgKind::Int64:
+		spec += "ll";
+		spec += conversion.conversion;
+		if (conversion.conversion == 'd' || conversion.conversion == 'i')
+			std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<long long>(value.bits));
+		else
+			std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<unsigned long long>(value.bits));
+		break;
+	case ts2fix::TraceArgKind::Double:
+		spec += conversion.conversion;
+		std::snprintf(buffer, sizeof(buffer), spec.c_str(), value.real);
+		break;
+	case ts2fix::TraceArgKind::Pointer:
+		// The way MSVC prints %p: zero-padded upper-case hex, as wide as the recording process's pointers.
+		std::snprintf(buffer, sizeof(buffer), "%0*llX", static_cast<int>(pointerSize * 2), static_cast<unsigned long long>(value.bits));
+		break;
+	case ts2fix::TraceArgKind::String:
+		spec += 's';
+		std::snprintf(buffer, sizeof(buffer), spec.c_str(), value.text.c_str());
+		break;
+	default:
+		buffer[0] = '\0';
+		break;
+	}
+	out += buffer;
+}
+
+std::string RenderMessage(const FormatDefinition& definition, const std::vector<ArgValue>& args, uint32_t pointerSize)
+{
+	std::string message;
+	std::size_t next = 0;
+	const char* cursor = definition.format.c_str();
+	ts2fix::TraceConversion conversion;
+	while (ts2fix::NextTraceConversion(cursor, conversion))
+	{
+		message.append(conversion.literal, conversion.literalLength);
+		if (conversion.spec != nullptr)
+			RenderConversion(conversion, args, next, pointerSize, message);
+	}
+
+	while (!message.empty() && (message.back() == '\n' || message.back() == '\r'))
+		message.pop_back();
+	return message;
+}
+
+void PrintCsvField(const std::string& text)
+{
+	std::putchar('"');
+	for (char c : text)
+	{
+		if (c == '"')
+			std::putchar('"');
+		std::putchar(c == '\n' ? ' ' : c);
+	}
+	std::putchar('"');
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	std::vector<uint8_t> data;
+	if (!ReadFile(options.path, data))
+	{
+		std::fprintf(stderr, "TraceDecoder: cannot read %s\n", options.path);
+		return 1;
+	}
+
+	ts2fix::TraceFileHeader header = {};
+	if (data.size() < sizeof(header))
+	{
+		std::fprintf(stderr, "TraceDecoder: %s is too short for a trace\n", options.path);
+		return 1;
+	}
+	std::memcpy(&header, data.data(), sizeof(header));
+	if (std::memcmp(header.magic, ts2fix::kTraceMagic, sizeof(header.magic)) != 0 || header.version != ts2fix::kTraceVersion
+		|| header.qpcFrequency <= 0)
+	{
+		std::fprintf(stderr, "TraceDecoder: %s is not a version %u trace\n", options.path, ts2fix::kTraceVersion);
+		return 1;
+	}
+
+	// First pass: format definitions, which may come after events that use them.
+	std::unordered_map<uint16_t, FormatDefinition> formats;
+	std::size_t end = sizeof(header);
+	for (std::size_t offset = sizeof(header); data.size() - offset >= sizeof(ts2fix::TraceRecordHeader);)
+	{
+		ts2fix::TraceRecordHeader record = {};
+		std::memcpy(&record, data.data() + offset, sizeof(record));
+		if (record.size < sizeof(record) || record.size > data.size() - offset)
+			break;
+
+		RecordReader reader = { data.data() + offset, record.size, sizeof(record) };
+		if (record.type == ts2fix::TraceRecordType::Format && !ReadFormat(reader, formats))
+			break;
+		offset += record.size;
+		end = offset;
+	}
+	if (end != data.size())
+		std::fprintf(stderr, "TraceDecoder: ignoring %zu bytes of incomplete records at the end\n", data.size() - end);
+
+	if (options.csv)
+		std::printf("time_ms,thread,subsystem,message\n");
+
+	std::vector<ArgValue> args;
+	std::size_t events = 0;
+	std::size_t undecodable = 0;
+	for (std::size_t offset = sizeof(header); offset < end;)
+	{
+		ts2fix::TraceRecordHeader record = {};
+		std::memcpy(&record, data.data() + offset, sizeof(record));
+		RecordReader reader = { data.data() + offset, record.size, sizeof(record) };
+		offset += record.size;
+		if (record.type != ts2fix::TraceRecordType::Event)
+			continue;
+
+		uint16_t id = 0;
+		uint32_t threadId = 0;
+		int64_t qpc = 0;
+		if (!reader.Get(id) || !reader.Get(threadId) || !reader.Get(qpc))
+		{
+			undecodable += 1;
+			continue;
+		}
+
+		const auto format = formats.find(id);
+		if (format == formats.end() || !ReadArgs(reader, format->second, args))
+		{
+			undecodable += 1;
+			continue;
+		}
+		if (options.subsystem != nullptr && format->second.subsystem != options.subsystem)
+			continue;
+
+		const double timeMs = static_cast<double>(qpc - header.startQpc) * 1000.0 / static_cast<double>(header.qpcFrequency);
+		const std::string message = RenderMessage(format->second, args, header.pointerSize);
+		if (options.csv)
+		{
+			std::printf("%.3f,%" PRIu32 ",", timeMs, threadId);
+			PrintCsvField(format->second.subsystem);
+			std::putchar(',');
+			PrintCsvField(message);
+			std::putchar('\n');
+		}
+		else
+		{
+			std::printf("%12.3f [%5" PRIu32 "] ToyStory2Fix:%s: %s\n", timeMs, threadId, format->second.subsystem.c_str(), message.c_str());
+		}
+		events += 1;
+	}
+
+	std::fprintf(stderr, "TraceDecoder: %zu events, %zu formats", events, formats.size());
+	if (undecodable != 0)
+		std::fprintf(stderr, ", %zu events without a readable format", undecodable);
+	std::fprintf(stderr, "\n");
+	return 0;
+}
@@ -22,8 +22,13 @@
 
 #include "IniReader.h"
 #include "ts2fix/config.h"
+#include "ts2fix/config_snapshot.h"
+#include "ts2fix/frame_telemetry.h"
 #include "ts2fix/frame_timer_install.h"
+#include "ts2fix/live_metrics.h"
 #include "ts2fix/logging.h"
+#include "ts2fix/pattern_utils.h"
+#include "ts2fix/vblank_clock.h"
 
 namespace
 {
@@ -39,7 +44,6 @@ struct ModernDepthConfig
 	bool debugOverlay = false;
 };
 
-HMODULE g_module = nullptr;
 HMODULE g_realDdraw = nullptr;
 
 using DirectDrawCreateFn = HRESULT(WINAPI*)(GUID*, LPDIRECTDRAW*, IUnknown*);
@@ -53,6 +57,8 @@ DirectDrawEnumerateAFn g_realDirectDrawEnumerateA = nullptr;
 ModernDepthConfig g_config = {};
 std::once_flag g_initOnce;
 std::once_flag g_wrapperTimingOnce;
+std::once_flag g_vblankClockOnce;
+LPDIRECTDRAW g_vblankDirectDraw = nullptr;
 
 struct HookTable
 {
@@ -83,12 +89,6 @@ using CreateDevice3Fn = HRESULT(STDMETHODCALLTYPE*)(void*, REFCLSID, IDirectDraw
 using SetRenderStateFn = HRESULT(STDMETHODCALLTYPE*)(void*, D3DRENDERSTATETYPE, DWORD);
 using SetTransformFn = HRESULT(STDMETHODCALLTYPE*)(void*, D3DTRANSFORMSTATETYPE, D3DMATRIX*);
 
-bool FileExists(const std::string& path)
-{
-	const DWORD attrs = GetFileAttributesA(path.c_str());
-	return attrs != INVALID_FILE_ATTRIBUTES && (attrs & FILE_ATTRIBUTE_DIRECTORY) == 0;
-}
-
 std::string ToLower(std::string value)
 {
 	std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
@@ -105,84 +105,17 @@ void Log(const char* fmt, ...)
 	ts2fix::Log("ModernDepth", "%s", body);
 }
 
-std::string GetModuleDirectory()
-{
-	char modulePath[MAX_PATH] = {};
-	if (g_module == nullptr || GetModuleFileNameA(g_module, modulePath, MAX_PATH) == 0)
-		return {};
-
-	std::string path = modulePath;
-	const std::size_t slash = path.find_last_of("\\/");
-	if (slash == std::string::npos)
-		return {};
-	return path.substr(0, slash + 1);
-}
-
-std::string ResolveIniPath()
-{
-	const std::string moduleDir = GetModuleDirectory();
-	if (moduleDir.empty())
-		return {};
-
-	const std::string scriptsIni = moduleDir + "scripts\\ToyStory2Fix.ini";
-	if (FileExists(scriptsIni))
-		return scriptsIni;
-
-	const std::string rootIni = moduleDir + "ToyStory2Fix.ini";
-	if (FileExists(rootIni))
-		return rootIni;
-
-	return scriptsIni;
-}
-
-bool ParseBoolean(const std::string& value, bool defaultValue)
-{
-	const std::string lower = ToLower(value);
-	if (lower == "1" || lower == "true" || lower == "yes" || lower == "on")
-		return true;
-	if (lower == "0" || lower == "false" || lower == "no" || lower == "off")
-		return false;
-	return defaultValue;
-}
-
-bool ReadIniBoolean(const std::string& iniPath, const char* section, const char* key, bool defaultValue)
-{
-	char buffer[64] = {};
-	GetPrivateProfileStringA(section, key, defaultValue ? "true" : "false", buffer, static_cast<DWORD>(sizeof(buffer)), iniPath.c_str());
-	return ParseBoolean(buffer, defaultValue);
-}
-
-float ReadIniFloat(const std::string& iniPath, const char* section, const char* key, float defaultValue)
-{
-	char buffer[64] = {};
-	std::snprintf(buffer, sizeof(buffer), "%.3f", defaultValue);
-	GetPrivateProfileStringA(section, key, buffer, buffer, static_cast<DWORD>(sizeof(buffer)), iniPath.c_str());
-
-	char* end = nullptr;
-	const float value = std::strtof(buffer, &end);
-	if (end == buffer || !std::isfinite(value))
-		return defaultValue;
-	return value;
-}
-
-std::string ReadIniString(const std::string& iniPath, const char* section, const char* key, const char* defaultValue)
-{
-	char buffer[64] = {};
-	GetPrivateProfileStringA(section, key, defaultValue, buffer, static_cast<DWORD>(sizeof(buffer)), iniPath.c_str());
-	return buffer;
-}
-
 void LoadConfig()
 {
-	const std::string iniPath = ResolveIniPath();
-	g_config.enabled = ReadIniBoolean(iniPath, "Rendering", "modern_depth_pipeline", true);
-	g_config.reversedZ = ReadIniBoolean(iniPath, "Rendering", "modern_depth_reversed_z", false);
-	g_config.dynamicNear = ReadIniBoolean(iniPath, "Rendering", "modern_depth_dynamic_near", true);
-	g_config.nearMin = std::max(0.1f, ReadIniFloat(iniPath, "Rendering", "modern_depth_near_min", 1.0f));
-	g_config.nearMax = std::max(g_config.nearMin, ReadIniFloat(iniPath, "Rendering", "modern_depth_near_max", 300.0f));
-	g_config.farPlane = std::max(g_config.nearMin + 1.0f, ReadIniFloat(iniPath, "Rendering", "modern_depth_far", 20000.0f));
-	g_config.depthFormat = ToLower(ReadIniString(iniPath, "Rendering", "modern_depth_format", "auto"));
-	g_config.debugOverlay = ReadIniBoolean(iniPath, "Rendering", "modern_depth_debug_overlay", false);
+	const ts2fix::RenderingConfig& rendering = ts2fix::GetSharedConfig().rendering;
+	g_config.enabled = rendering.modernDepthPipeline;
+	g_config.reversedZ = rendering.modernDepthReversedZ;
+	g_config.dynamicNear = rendering.modernDepthDynamicNear;
+	g_config.nearMin = rendering.modernDepthNearMin;
+	g_config.nearMax = rendering.modernDepthNearMax;
+	g_config.farPlane = rendering.modernDepthFar;
+	g_config.depthFormat = rendering.modernDepthFormat;
+	g_config.debugOverlay = rendering.modernDepthDebugOverlay;
 
 	Log("Config enabled=%d reversed_z=%d dynamic_near=%d near=[%.2f, %.2f] far=%.2f depth_format=%s\n",
 		g_config.enabled ? 1 : 0,
@@ -222,9 +155,10 @@ void EnsureInitialized()
 
 void InitializeWrapperTimingPipeline()
 {
-	CIniReader iniReader("scripts\\ToyStory2Fix.ini");
-	ts2fix::Config config = ts2fix::LoadConfig(iniReader);
+	const ts2fix::Config& config = ts2fix::GetSharedConfig();
+	ts2fix::SetDiagnosticSubsystems(config.framerate.diagnosticSubsystems);
 	ts2fix::SetDiagnosticsEnabled(config.framerate.diagnostics);
+	ts2fix::SetDiagnosticTraceEnabled(config.framerate.diagnosticTrace);
 
 	if (!config.framerate.enabled)
 	{
@@ -232,6 +166,12 @@ void InitializeWrapperTimingPipeline()
 		return;
 	}
 
+	if (config.framerate.liveMetrics)
+		ts2fix::OpenLiveMetrics(ts2fix::kLiveMetricsPublisherWrapper);
+
+	hook::set_scan_threads(config.advanced.scanThreads);
+	// The ASI has patched the executable by now, so this pass must not rewrite the signature cache.
+	ts2fix::PrefetchSignatures(false);
 	const bool installed = ts2fix::InstallFrameTimerHooks(config);
 	Log("Wrapper timing pipeline install %s.\n", installed ? "succeeded" : "failed");
 }
@@ -241,6 +181,34 @@ void EnsureWrapperTimingInitialized()
 	std::call_once(g_wrapperTimingOnce, InitializeWrapperTimingPipeline);
 }
 
+bool WaitForVblank(void* context)
+{
+	auto* directDraw = static_cast<LPDIRECTDRAW>(context);
+	return SUCCEEDED(directDraw->WaitForVerticalBlank(DDWAITVB_BLOCKBEGIN, nullptr));
+}
+
+void CreateVblankSampler(GUID* guid)
+{
+	if (!ts2fix::IsVblankClockEnabled() || g_realDirectDrawCreate == nullptr)
+		return;
+
+	// The sampler gets its own object on the game's display rather than a reference to the game's: the game releases
+	// and recreates its object around mode switches, and an extra reference would keep the old one (and its
+	// exclusive mode) alive. No cooperative level is needed to wait for a vblank.
+	if (FAILED(g_realDirectDrawCreate(guid, &g_vblankDirectDraw, nullptr)) || g_vblankDirectDraw == nullptr)
+	{
+		Log("Vblank lock unavailable: could not create a DirectDraw object for the sampler.\n");
+		return;
+	}
+
+	ts2fix::StartVblankClock(WaitForVblank, g_vblankDirectDraw);
+}
+
+void EnsureVblankClockStarted(GUID* guid)
+{
+	std::call_once(g_vblankClockOnce, CreateVblankSampler, guid);
+}
+
 bool PatchVtableEntry(void** slotAddress, void* detourAddress)
 {
 	DWORD oldProtect = 0;
@@ -293,11 +261,11 @@ bool HookMethod(HookTable& table, void* object, std::size_t vtableIndex, T detou
 
 	if (!PatchVtableEntry(slotAddress, reinterpret_cast<void*>(detour)))
 	{
-		Log("Failed to patch %s at slot %zu (err=%lu)\n", name, vtableIndex, GetLastError());
+		TS2FIX_LOG_LIMITED(ModernDepth, "Failed to patch %s at slot %zu (err=%lu)\n", name, vtableIndex, GetLastError());
 		return false;
 	}
 
-	Log("Hooked %s slot=%zu\n", name, vtableIndex);
+	TS2FIX_LOG_LIMITED(ModernDepth, "Hooked %s slot=%zu\n", name, vtableIndex);
 	return true;
 }
 
@@ -459,7 +427,7 @@ HRESULT STDMETHODCALLTYPE CreateSurfaceHook(void* self, DDSURFACEDESC* surfaceDe
 		const HRESULT hr = original(self, &patched, surface, outer);
 		if (SUCCEEDED(hr))
 		{
-			Log("CreateSurface zbuffer request promoted to %d-bit.\n", bits);
+			TS2FIX_LOG_LIMITED(ModernDepth, "CreateSurface zbuffer request promoted to %d-bit.\n", bits);
 			return hr;
 		}
 	}
@@ -482,7 +450,7 @@ HRESULT STDMETHODCALLTYPE CreateSurface2Hook(void* self, DDSURFACEDESC2* surface
 		const HRESULT hr = original(self, &patched, surface, outer);
 		if (SUCCEEDED(hr))
 		{
-			Log("CreateSurface2 zbuffer request promoted to %d-bit.\n", bits);
+			TS2FIX_LOG_LIMITED(ModernDepth, "CreateSurface2 zbuffer request promoted to %d-bit.\n", bits);
 			return hr;
 		}
 	}
@@ -543,6 +511,7 @@ HRESULT STDMETHODCALLTYPE SetTransformHook(void* self, D3DTRANSFORMSTATETYPE sta
 
 	D3DMATRIX patched = *matrix;
 	ApplyDepthProjectionPolicy(patched);
+	TS2FIX_LOG_DIAGNOSTIC(ModernDepth, "Projection _33/_43 %.6f/%.6f -> %.6f/%.6f\n", matrix->_33, matrix->_43, patched._33, patched._43);
 	return original(self, state, &patched);
 }
 
@@ -634,6 +603,8 @@ extern "C" HRESULT WINAPI TS2Fix_DirectDrawCreate(GUID* guid, LPDIRECTDRAW* dire
 	const HRESULT hr = g_realDirectDrawCreate(guid, directDraw, outer);
 	if (SUCCEEDED(hr) && directDraw != nullptr && *directDraw != nullptr && g_config.enabled)
 		HookDirectDrawInterface(*directDraw, false);
+	if (SUCCEEDED(hr))
+		EnsureVblankClockStarted(guid);
 	return hr;
 }
 
@@ -647,6 +618,8 @@ extern "C" HRESULT WINAPI TS2Fix_DirectDrawCreateEx(GUID* guid, LPVOID* directDr
 	const HRESULT hr = g_realDirectDrawCreateEx(guid, directDraw, iid, outer);
 	if (SUCCEEDED(hr) && directDraw != nullptr && *directDraw != nullptr && g_config.enabled)
 		HookInterfaceByIid(*directDraw, iid);
+	if (SUCCEEDED(hr))
+		EnsureVblankClockStarted(guid);
 	return hr;
 }
 
@@ -658,12 +631,14 @@ extern "C" HRESULT WINAPI TS2Fix_DirectDrawEnumerateA(LPDDENUMCALLBACKA callback
 	return g_realDirectDrawEnumerateA(callback, context);
 }
 
-BOOL APIENTRY DllMain(HMODULE module, DWORD reason, LPVOID /*reserved*/)
+BOOL APIENTRY DllMain(HMODULE module, DWORD reason, LPVOID reserved)
 {
 	if (reason == DLL_PROCESS_ATTACH)
-	{
-		g_module = module;
 		DisableThreadLibraryCalls(module);
+	else if (reason == DLL_PROCESS_DETACH && reserved != nullptr)
+	{
+		ts2fix::FlushFrameTelemetry();
+		ts2fix::FlushLogAtProcessExit();
 	}
 	return TRUE;
 }